@@ -0,0 +1,26 @@
+#pragma once
+
+#include <itkImage.h>
+
+// Previous (per-voxel GetPixel) implementations, kept as the baseline for benchmarks
+namespace reference {
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&);
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Pointer&);
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&);
+
+    template <typename PixelType>
+    PixelType get_max_pixel_value(const typename itk::Image<PixelType, 3>::Pointer&);
+
+    // Isotropic resampling through itk::ResampleImageFilter (linear interpolator)
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    resampling_ct_image(const typename itk::Image<PixelType, 3>::Pointer&);
+}
@@ -0,0 +1,961 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <type_traits>
+
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+#include <itkImageFileReader.h>
+
+#include <image/core.hpp>
+#include <image/io.hpp>
+#include <image/mip.hpp>
+#include <image/stream.hpp>
+#include <image/view.hpp>
+#include <image/bgzf.hpp>
+#include <image/mask.hpp>
+#include <image/nifti.hpp>
+#include <hist/core.hpp>
+
+#include "reference.hpp"
+
+
+// Best-of-n wall time in milliseconds
+template <typename Function>
+double measure(Function&& function, const int& repeat = 3) {
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+
+// Synthetic CT-like volume: air background with a bright block in the middle
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+make_volume(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 3>::SizeType size;
+    size[0] = nx;
+    size[1] = ny;
+    size[2] = nz;
+
+    typename itk::Image<PixelType, 3>::RegionType region;
+    region.SetSize(size);
+
+    auto img = itk::Image<PixelType, 3>::New();
+    img->SetRegions(region);
+    img->Allocate();
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> noise(-1024, 3071);
+    PixelType* buffer = img->GetBufferPointer();
+    const std::size_t voxels = nx * ny * nz;
+    for (std::size_t i = 0; i < voxels; ++i) {
+        buffer[i] = static_cast<PixelType>(noise(rng));
+    }
+
+    return img;
+}
+
+
+// Linear ramp: reproduced exactly by any linear interpolation, so rotations of it differ by rounding and edges only
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+make_ramp(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 3>::SizeType size;
+    size[0] = nx;
+    size[1] = ny;
+    size[2] = nz;
+
+    typename itk::Image<PixelType, 3>::RegionType region;
+    region.SetSize(size);
+
+    auto img = itk::Image<PixelType, 3>::New();
+    img->SetRegions(region);
+    img->Allocate();
+
+    PixelType* buffer = img->GetBufferPointer();
+    for (std::size_t z = 0; z < nz; ++z) {
+        for (std::size_t y = 0; y < ny; ++y) {
+            for (std::size_t x = 0; x < nx; ++x) {
+                buffer[(z * ny + y) * nx + x] = static_cast<PixelType>(static_cast<long>(x + 2 * y + 3 * z) - 1024);
+            }
+        }
+    }
+
+    return img;
+}
+
+
+template <typename PixelType>
+bool same_image(
+    const typename itk::Image<PixelType, 2>::Pointer& a,
+    const typename itk::Image<PixelType, 2>::Pointer& b
+) {
+    const std::size_t pixels = a->GetLargestPossibleRegion().GetNumberOfPixels();
+    if (pixels != b->GetLargestPossibleRegion().GetNumberOfPixels()) return false;
+    return std::equal(a->GetBufferPointer(), a->GetBufferPointer() + pixels, b->GetBufferPointer());
+}
+
+
+void report(const std::string& name, const double& before, const double& after, const bool& same) {
+    std::cout << std::left << std::setw(24) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << before << " ms"
+              << std::setw(12) << after << " ms"
+              << std::setw(10) << before / after << "x"
+              << (same ? "" : "   MISMATCH") << std::endl;
+}
+
+
+// MIP kernels: per-voxel GetPixel baseline vs buffer kernels
+template <typename PixelType>
+void bench_mip(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    typename itk::Image<PixelType, 2>::Pointer before, after;
+
+    std::cout << "[mip] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    double t0 = measure([&] { before = reference::compute_coronal_mip_image<PixelType>(img); });
+    double t1 = measure([&] { after = panorama::compute_coronal_mip_image<PixelType>(img); });
+    report("coronal", t0, t1, same_image<PixelType>(before, after));
+
+    t0 = measure([&] { before = reference::compute_axial_mip_image<PixelType>(img); });
+    t1 = measure([&] { after = panorama::compute_axial_mip_image<PixelType>(img); });
+    report("axial", t0, t1, same_image<PixelType>(before, after));
+
+    t0 = measure([&] { before = reference::compute_sagittal_mip_image<PixelType>(img); });
+    t1 = measure([&] { after = panorama::compute_sagittal_mip_image<PixelType>(img); });
+    report("sagittal", t0, t1, same_image<PixelType>(before, after));
+
+    PixelType max_before = 0, max_after = 0;
+    t0 = measure([&] { max_before = reference::get_max_pixel_value<PixelType>(img); });
+    t1 = measure([&] { max_after = panorama::get_max_pixel_value<PixelType>(img); });
+    report("max value", t0, t1, max_before == max_after);
+}
+
+
+// Separate MIP passes + max vs single orthogonal sweep, in memory and streamed from a .nii file
+template <typename PixelType>
+void bench_orthogonal(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    namespace fs = boost::filesystem;
+
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    typename itk::Image<PixelType, 2>::Pointer axial, coronal, sagittal;
+    PixelType max_value = 0;
+    panorama::OrthogonalMIPs<PixelType> mips;
+
+    std::cout << "[orthogonal] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    const double t0 = measure([&] {
+        axial = panorama::compute_axial_mip_image<PixelType>(img);
+        coronal = panorama::compute_coronal_mip_image<PixelType>(img);
+        sagittal = panorama::compute_sagittal_mip_image<PixelType>(img);
+        max_value = panorama::get_max_pixel_value<PixelType>(img);
+    });
+    const double t1 = measure([&] { mips = panorama::compute_orthogonal_mips<PixelType>(img); });
+    report("axial+coronal+sagittal", t0, t1,
+           same_image<PixelType>(axial, mips.axial) &&
+           same_image<PixelType>(coronal, mips.coronal) &&
+           same_image<PixelType>(sagittal, mips.sagittal) &&
+           max_value == mips.max_value);
+
+    // First pass of a case: coronal MIP + max from the file, slab by slab, vs one sweep of each slab
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.nii");
+    panorama::write_image<PixelType>(img, path.string());
+    const panorama::OrthogonalMIPs<PixelType> expected = panorama::compute_orthogonal_mips<PixelType>(img, true);
+
+    const double t2 = measure([&] {
+        coronal = panorama::compute_coronal_mip_image<PixelType>(path.string());
+        max_value = panorama::get_max_pixel_value<PixelType>(panorama::read_image<PixelType>(path.string()), true);
+    });
+    const double t3 = measure([&] { mips = panorama::compute_orthogonal_mips<PixelType>(path.string()); });
+    report("first pass (file)", t2, t3,
+           mips.coronal && same_image<PixelType>(coronal, mips.coronal) &&
+           same_image<PixelType>(expected.axial, mips.axial) &&
+           same_image<PixelType>(expected.sagittal, mips.sagittal) &&
+           max_value == mips.max_value && expected.max_value == mips.max_value);
+
+    boost::system::error_code ec;
+    fs::remove(path, ec);
+}
+
+
+// Output buffer of one stage widened to double, so double and short runs can be compared
+template <typename Image>
+std::vector<double> values_of(const typename Image::Pointer& img) {
+    const auto* buffer = img->GetBufferPointer();
+    return std::vector<double>(buffer, buffer + img->GetLargestPossibleRegion().GetNumberOfPixels());
+}
+
+
+// One volume-sized stage chain for a pixel type: memory footprint, time and output per stage
+template <typename PixelType>
+std::vector<double> run_pixel_type(
+    const std::size_t& nx, const std::size_t& ny, const std::size_t& nz,
+    std::vector<std::vector<double>>& outputs
+) {
+    using Volume = itk::Image<PixelType, 3>;
+    using Plane = itk::Image<PixelType, 2>;
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    std::vector<double> times;
+    typename Volume::Pointer windowed;
+    typename Plane::Pointer coronal, axial, sagittal;
+    panorama::OrthogonalMIPs<PixelType> mips;
+
+    times.push_back(measure([&] { windowed = panorama::window_ct_image<PixelType>(img); }));
+    outputs.push_back(values_of<Volume>(windowed));
+    times.push_back(measure([&] { panorama::window_ct_image_inplace<PixelType>(img); }));
+    outputs.push_back(values_of<Volume>(img));
+    times.push_back(measure([&] { coronal = panorama::compute_coronal_mip_image<PixelType>(img); }));
+    outputs.push_back(values_of<Plane>(coronal));
+    times.push_back(measure([&] { axial = panorama::compute_axial_mip_image<PixelType>(img); }));
+    outputs.push_back(values_of<Plane>(axial));
+    times.push_back(measure([&] { sagittal = panorama::compute_sagittal_mip_image<PixelType>(img); }));
+    outputs.push_back(values_of<Plane>(sagittal));
+    times.push_back(measure([&] { mips = panorama::compute_orthogonal_mips<PixelType>(img); }));
+    std::vector<double> orthogonal = values_of<Plane>(mips.axial);
+    for (const auto& plane : {mips.coronal, mips.sagittal}) {
+        const std::vector<double> values = values_of<Plane>(plane);
+        orthogonal.insert(orthogonal.end(), values.begin(), values.end());
+    }
+    orthogonal.push_back(static_cast<double>(mips.max_value));
+    outputs.push_back(orthogonal);
+
+    return times;
+}
+
+// double vs short volumes; make_volume draws integer HU, so both types must give the same outputs
+void bench_pixel_type(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    const std::size_t voxels = nx * ny * nz;
+    std::cout << "[pixel type] " << nx << "x" << ny << "x" << nz
+              << ", volume " << voxels * sizeof(double) / (1024 * 1024) << " MiB (double) vs "
+              << voxels * sizeof(short) / (1024 * 1024) << " MiB (short)" << std::endl;
+
+    const std::vector<std::string> names = {
+        "window (copy)", "window (in place)", "coronal", "axial", "sagittal", "orthogonal"
+    };
+    std::vector<std::vector<double>> outputs_before, outputs_after;
+    const std::vector<double> before = run_pixel_type<double>(nx, ny, nz, outputs_before);
+    const std::vector<double> after = run_pixel_type<short>(nx, ny, nz, outputs_after);
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        report(names[i], before[i], after[i], outputs_before[i] == outputs_after[i]);
+    }
+}
+
+
+// Mean and max |a - b| over voxels at least `margin` voxels inside the volume
+template <typename PixelType>
+std::pair<double, double> difference(
+    const typename itk::Image<PixelType, 3>::Pointer& a,
+    const typename itk::Image<PixelType, 3>::Pointer& b,
+    const std::size_t& margin = 2
+) {
+    const auto size = a->GetLargestPossibleRegion().GetSize();
+    double sum = 0, max = 0;
+    std::size_t count = 0;
+    for (std::size_t z = margin; z + margin < size[2]; ++z) {
+        for (std::size_t y = margin; y + margin < size[1]; ++y) {
+            for (std::size_t x = margin; x + margin < size[0]; ++x) {
+                const std::size_t i = (z * size[1] + y) * size[0] + x;
+                const double d = std::abs(static_cast<double>(a->GetBufferPointer()[i]) - b->GetBufferPointer()[i]);
+                sum += d;
+                max = std::max(max, d);
+                ++count;
+            }
+        }
+    }
+    return std::make_pair(count > 0 ? sum / count : 0.0, max);
+}
+
+
+// Single-axis poses: ITK resampling vs three 1-D shear passes (transform_ct_image engines)
+template <typename PixelType>
+void bench_shear(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    using Image = itk::Image<PixelType, 3>;
+    const double angle = 4.0;
+    typename Image::SpacingType spacing;
+    spacing[0] = 0.4;
+    spacing[1] = 0.4;
+    spacing[2] = 0.5;
+
+    std::cout << "[shear] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels, " << angle << " deg" << std::endl;
+
+    // Sampling region of a driver: the middle half of the slices and of each plane axis
+    typename Image::RegionType region;
+    region.SetIndex({static_cast<long>(nx / 4), static_cast<long>(ny / 4), static_cast<long>(nz / 4)});
+    region.SetSize({nx / 2, ny / 2, nz / 2});
+
+    const std::vector<std::pair<std::string, itk::Matrix<double, 3, 3>>> poses = {
+        {"x", panorama::calc_rotation_matrix('x', angle)},
+        {"y", panorama::calc_rotation_matrix('y', angle)},
+        {"z", panorama::calc_rotation_matrix('z', angle)},
+        {"z * z", panorama::calc_rotation_matrix('z', angle) * panorama::calc_rotation_matrix('z', -1.5)},
+        {"z * x(0)", panorama::calc_rotation_matrix('z', angle) * panorama::calc_rotation_matrix('x', 0)},
+        {"z * x (resampled)", panorama::calc_rotation_matrix('z', angle) * panorama::calc_rotation_matrix('x', angle)}
+    };
+    for (const auto& pose : poses) {
+        for (const bool cropped : {false, true}) {
+            const typename Image::RegionType kept = cropped ? region : typename Image::RegionType(typename Image::SizeType{nx, ny, nz});
+            std::pair<double, double> linear, noise;
+            {
+                auto img = make_ramp<PixelType>(nx, ny, nz);
+                img->SetSpacing(spacing);
+                linear = difference<PixelType>(
+                    panorama::transform_ct_image<PixelType>(img, pose.second, kept),
+                    panorama::transform_ct_image<PixelType>(img, pose.second, kept, panorama::RotationEngine::Shear));
+            }
+
+            auto img = make_volume<PixelType>(nx, ny, nz);
+            img->SetSpacing(spacing);
+            typename Image::Pointer before, after;
+            const double t0 = measure([&] { before = panorama::transform_ct_image<PixelType>(img, pose.second, kept); });
+            const double t1 = measure([&] {
+                after = panorama::transform_ct_image<PixelType>(img, pose.second, kept, panorama::RotationEngine::Shear);
+            });
+            noise = difference<PixelType>(before, after);
+
+            // A region gives exactly the voxels of the whole output (the resampler only up to rounding)
+            bool same_region = true;
+            if (cropped && pose.first.find("resampled") == std::string::npos) {
+                const auto whole = panorama::transform_ct_image<PixelType>(img, pose.second, {0, static_cast<short>(nz)},
+                                                                           panorama::RotationEngine::Shear);
+                same_region = difference<PixelType>(panorama::crop_image<PixelType>(whole, region), after, 0).second == 0;
+            }
+
+            // Geometry is checked on the ramp; noise shows the worst-case interpolation difference
+            report("pose " + pose.first + (cropped ? " (region)" : ""), t0, t1,
+                   before->GetLargestPossibleRegion().GetSize() == after->GetLargestPossibleRegion().GetSize() &&
+                   before->GetOrigin() == after->GetOrigin() && linear.first < 0.1 && same_region);
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  |diff| mean/max: ramp " << linear.first << "/" << linear.second
+                      << ", noise " << noise.first << "/" << noise.second << std::defaultfloat << std::endl;
+        }
+    }
+}
+
+
+// Physical box -> index region: calc_output_region vs testing every voxel center against the box
+template <typename PixelType>
+void bench_region(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    using Image = itk::Image<PixelType, 3>;
+
+    // The scan tests every voxel for every box, so the grid is kept small
+    typename Image::SizeType size;
+    size[0] = std::min<std::size_t>(nx, 48);
+    size[1] = std::min<std::size_t>(ny, 40);
+    size[2] = std::min<std::size_t>(nz, 32);
+    auto img = Image::New();
+    img->SetRegions(typename Image::RegionType(size));
+    typename Image::SpacingType spacing;
+    spacing[0] = 0.4;
+    spacing[1] = 0.45;
+    spacing[2] = 0.5;
+    img->SetSpacing(spacing);
+    typename Image::PointType origin;
+    origin[0] = -100.0;
+    origin[1] = -80.0;
+    origin[2] = 30.0;
+    img->SetOrigin(origin);
+
+    typename Image::DirectionType identity, lps, permuted;
+    identity.SetIdentity();
+    lps.SetIdentity();
+    lps[0][0] = -1;
+    lps[1][1] = -1;
+    permuted.Fill(0);
+    permuted[0][2] = 1;
+    permuted[1][0] = 1;
+    permuted[2][1] = -1;
+    const typename Image::DirectionType oblique = panorama::calc_rotation_matrix('z', 30.0);
+    const std::vector<std::pair<std::string, typename Image::DirectionType>> grids = {
+        {"identity", identity}, {"LPS", lps}, {"permuted", permuted}, {"oblique", oblique}
+    };
+
+    std::cout << "[region] " << size[0] << "x" << size[1] << "x" << size[2] << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    for (const auto& grid : grids) {
+        img->SetDirection(grid.second);
+        const bool aligned = grid.first != "oblique";
+
+        // Physical extent of the grid, and boxes in it: random, on voxel centers (faces exactly on centers), outside
+        double low[3] = {1e9, 1e9, 1e9}, high[3] = {-1e9, -1e9, -1e9};
+        for (int corner = 0; corner < 8; ++corner) {
+            typename Image::IndexType index;
+            for (int i = 0; i < 3; ++i) {
+                index[i] = (corner >> i) & 1 ? static_cast<long>(size[i]) - 1 : 0;
+            }
+            typename Image::PointType point;
+            img->TransformIndexToPhysicalPoint(index, point);
+            for (int i = 0; i < 3; ++i) {
+                low[i] = std::min(low[i], point[i]);
+                high[i] = std::max(high[i], point[i]);
+            }
+        }
+        std::mt19937 rng(0);
+        std::vector<std::pair<itk::Point<double, 3>, itk::Point<double, 3>>> boxes(64);
+        for (auto& box : boxes) {
+            for (int i = 0; i < 3; ++i) {
+                std::uniform_real_distribution<double> coordinate(low[i] - 5, high[i] + 5);
+                const double a = coordinate(rng), b = coordinate(rng);
+                box.first[i] = std::min(a, b);
+                box.second[i] = std::max(a, b);
+            }
+        }
+        typename Image::IndexType corner0, corner1;
+        corner0[0] = 3;
+        corner0[1] = 5;
+        corner0[2] = 2;
+        corner1[0] = static_cast<long>(size[0]) - 4;
+        corner1[1] = static_cast<long>(size[1]) / 2;
+        corner1[2] = static_cast<long>(size[2]) - 1;
+        typename Image::PointType center0, center1;
+        img->TransformIndexToPhysicalPoint(corner0, center0);
+        img->TransformIndexToPhysicalPoint(corner1, center1);
+        std::pair<itk::Point<double, 3>, itk::Point<double, 3>> on_centers, outside;
+        for (int i = 0; i < 3; ++i) {
+            on_centers.first[i] = std::min(center0[i], center1[i]);
+            on_centers.second[i] = std::max(center0[i], center1[i]);
+            outside.first[i] = high[i] + 1;
+            outside.second[i] = high[i] + 2;
+        }
+        boxes.push_back(on_centers);
+        boxes.push_back(outside);
+
+        std::vector<typename Image::RegionType> before(boxes.size()), after(boxes.size());
+        std::vector<bool> covered(boxes.size(), true);
+        const double t0 = measure([&] {
+            for (std::size_t b = 0; b < boxes.size(); ++b) {
+                long first[3] = {LONG_MAX, LONG_MAX, LONG_MAX}, last[3] = {-1, -1, -1};
+                typename Image::IndexType index;
+                for (index[2] = 0; index[2] < static_cast<long>(size[2]); ++index[2]) {
+                    for (index[1] = 0; index[1] < static_cast<long>(size[1]); ++index[1]) {
+                        for (index[0] = 0; index[0] < static_cast<long>(size[0]); ++index[0]) {
+                            typename Image::PointType point;
+                            img->TransformIndexToPhysicalPoint(index, point);
+                            bool inside = true;
+                            for (int i = 0; i < 3; ++i) {
+                                inside = inside && point[i] >= boxes[b].first[i] && point[i] <= boxes[b].second[i];
+                            }
+                            for (int i = 0; inside && i < 3; ++i) {
+                                first[i] = std::min<long>(first[i], index[i]);
+                                last[i] = std::max<long>(last[i], index[i]);
+                            }
+                        }
+                    }
+                }
+                typename Image::IndexType start;
+                typename Image::SizeType extent;
+                for (int i = 0; i < 3; ++i) {
+                    start[i] = last[i] < 0 ? 0 : first[i];
+                    extent[i] = last[i] < 0 ? 0 : static_cast<std::size_t>(last[i] - first[i] + 1);
+                }
+                before[b] = typename Image::RegionType(start, extent);
+            }
+        });
+        const double t1 = measure([&] {
+            for (std::size_t b = 0; b < boxes.size(); ++b) {
+                after[b] = panorama::calc_output_region<PixelType>(img, boxes[b].first, boxes[b].second);
+            }
+        });
+
+        // Axis-aligned grids: the same region (any empty one); oblique: the region holds every voxel inside
+        bool same = true;
+        for (std::size_t b = 0; b < boxes.size(); ++b) {
+            const bool empty = before[b].GetNumberOfPixels() == 0;
+            if (aligned) {
+                same = same && (empty ? after[b].GetNumberOfPixels() == 0 :
+                                before[b].GetIndex() == after[b].GetIndex() && before[b].GetSize() == after[b].GetSize());
+            } else if (!empty) {
+                for (int i = 0; i < 3; ++i) {
+                    same = same && after[b].GetIndex(i) <= before[b].GetIndex(i) &&
+                           after[b].GetIndex(i) + after[b].GetSize(i) >= before[b].GetIndex(i) + before[b].GetSize(i);
+                }
+            }
+        }
+        report("box -> region (" + grid.first + ")", t0, t1, same);
+    }
+}
+
+
+// Isotropic resampling of anisotropic slices: ITK resampling vs three separable passes
+template <typename PixelType>
+void bench_resample(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 3>::SpacingType spacing;
+    spacing[0] = 0.4;
+    spacing[1] = 0.4;
+    spacing[2] = 1.0;
+    std::cout << "[resample] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels, z spacing x" << spacing[2] / spacing[0] << std::endl;
+
+    std::pair<double, double> linear;
+    {
+        auto img = make_ramp<PixelType>(nx, ny, nz);
+        img->SetSpacing(spacing);
+        linear = difference<PixelType>(reference::resampling_ct_image<PixelType>(img), panorama::resampling_ct_image<PixelType>(img));
+    }
+
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    img->SetSpacing(spacing);
+    typename itk::Image<PixelType, 3>::Pointer before, after;
+    const double t0 = measure([&] { before = reference::resampling_ct_image<PixelType>(img); });
+    const double t1 = measure([&] { after = panorama::resampling_ct_image<PixelType>(img); });
+    const std::pair<double, double> noise = difference<PixelType>(before, after);
+
+    // Only the continuous index differs (ITK maps it through physical space), so values agree up to rounding
+    report("linear", t0, t1, linear.second <= 1);
+    std::cout << std::fixed << std::setprecision(3)
+              << "  |diff| mean/max: ramp " << linear.first << "/" << linear.second
+              << ", noise " << noise.first << "/" << noise.second << std::defaultfloat << std::endl;
+
+    // Catmull-Rom reproduces a ramp, so away from the clamped edges cubic agrees with linear up to rounding
+    const double tolerance = std::is_integral<PixelType>::value ? 1 : 1e-6;
+    std::pair<double, double> cubic;
+    {
+        auto ramp = make_ramp<PixelType>(nx, ny, nz);
+        ramp->SetSpacing(spacing);
+        cubic = difference<PixelType>(panorama::resampling_ct_image<PixelType>(ramp),
+                                      panorama::resampling_ct_image<PixelType>(ramp, panorama::ResampleKernel::Cubic), 5);
+    }
+    const double t2 = measure([&] { after = panorama::resampling_ct_image<PixelType>(img, panorama::ResampleKernel::Cubic); });
+    report("cubic", t0, t2, cubic.second <= tolerance);
+
+    // Box downsampling by 2 on every axis vs averaging each output voxel's neighbourhood directly:
+    // the box of width 2 centered on input voxel 2o covers it and half of each neighbour
+    typename itk::Image<PixelType, 3>::SpacingType fine, coarse;
+    fine.Fill(spacing[0]);
+    coarse.Fill(2 * spacing[0]);
+    img->SetSpacing(fine);
+    const std::size_t mx = nx / 2, my = ny / 2, mz = nz / 2;
+    const double t3 = measure([&] {
+        before = make_volume<PixelType>(mx, my, mz);
+        const PixelType* src = img->GetBufferPointer();
+        PixelType* dst = before->GetBufferPointer();
+        const double weight[3] = {0.25, 0.5, 0.25};
+        for (std::size_t z = 0; z < mz; ++z) {
+            for (std::size_t y = 0; y < my; ++y) {
+                for (std::size_t x = 0; x < mx; ++x) {
+                    double sum = 0;
+                    for (int k = 0; k < 3; ++k) {
+                        const std::size_t iz = std::min(std::max<long>(2 * z + k - 1, 0), static_cast<long>(nz) - 1);
+                        for (int j = 0; j < 3; ++j) {
+                            const std::size_t iy = std::min(std::max<long>(2 * y + j - 1, 0), static_cast<long>(ny) - 1);
+                            for (int i = 0; i < 3; ++i) {
+                                const std::size_t ix = std::min(std::max<long>(2 * x + i - 1, 0), static_cast<long>(nx) - 1);
+                                sum += weight[k] * weight[j] * weight[i] * src[(iz * ny + iy) * nx + ix];
+                            }
+                        }
+                    }
+                    dst[(z * my + y) * mx + x] = static_cast<PixelType>(sum);
+                }
+            }
+        }
+    });
+    const double t4 = measure([&] { after = panorama::resample_image<PixelType>(img, coarse, panorama::ResampleKernel::Box); });
+    const std::pair<double, double> box = difference<PixelType>(before, after);
+    report("box (2x down)", t3, t4, box.second <= tolerance);
+    std::cout << std::fixed << std::setprecision(3)
+              << "  |diff| max: cubic ramp " << cubic.second << ", box " << box.second << std::defaultfloat << std::endl;
+}
+
+
+// Posed MIPs: resample the volume then project vs interpolate through the pose
+template <typename PixelType>
+void bench_view(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    const itk::Matrix<double, 3, 3> pose = panorama::calc_rotation_matrix('z', 7.5);
+    const std::pair<short, short> roi_range(static_cast<short>(nz / 4), static_cast<short>(nz / 2));
+    typename itk::Image<PixelType, 2>::Pointer axial_before, sagittal_before, axial_after, sagittal_after;
+
+    std::cout << "[view] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    const double t0 = measure([&] {
+        auto posed = panorama::transform_ct_image<PixelType>(img, pose);
+        axial_before = panorama::compute_axial_mip_image<PixelType>(panorama::extract_slices<PixelType>(posed, roi_range, true));
+        sagittal_before = panorama::compute_sagittal_mip_image<PixelType>(posed);
+    });
+    const double t1 = measure([&] {
+        const panorama::TransformedVolume<PixelType> posed(img, pose);
+        axial_after = panorama::compute_axial_mip_image<PixelType>(posed.slices(roi_range));
+        sagittal_after = panorama::compute_sagittal_mip_image<PixelType>(posed);
+    });
+
+    // Both interpolate linearly; casts may round differently by one unit
+    auto close = [](const typename itk::Image<PixelType, 2>::Pointer& a, const typename itk::Image<PixelType, 2>::Pointer& b) {
+        const std::size_t pixels = a->GetLargestPossibleRegion().GetNumberOfPixels();
+        return pixels == b->GetLargestPossibleRegion().GetNumberOfPixels() &&
+               std::equal(a->GetBufferPointer(), a->GetBufferPointer() + pixels, b->GetBufferPointer(),
+                          [](const PixelType& u, const PixelType& v) { return std::abs(static_cast<double>(u) - v) <= 1; });
+    };
+    report("axial+sagittal (posed)", t0, t1, close(axial_before, axial_after) && close(sagittal_before, sagittal_after));
+}
+
+
+// Posed volumes of the same buffer under flipped directions: the pose is given on the index axes,
+// so the direction must not change the output
+template <typename PixelType>
+void bench_direction(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 3>::SpacingType spacing;
+    spacing[0] = 0.4;
+    spacing[1] = 0.4;
+    spacing[2] = 0.6;
+    const itk::Matrix<double, 3, 3> pose =
+        panorama::calc_rotation_matrix('z', 7.5) * panorama::calc_rotation_matrix('x', 4.0);
+
+    std::cout << "[direction] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    auto img = make_ramp<PixelType>(nx, ny, nz);
+    img->SetSpacing(spacing);
+    typename itk::Image<PixelType, 3>::Pointer before, after, view_before, view_after;
+    const double t0 = measure([&] { before = panorama::transform_ct_image<PixelType>(img, pose); });
+    const double t2 = measure([&] { view_before = panorama::TransformedVolume<PixelType>(img, pose).materialize(); });
+
+    for (const auto& [name, flip] : {std::make_pair(std::string("LPS"), std::array<double, 3>{-1, -1, 1}),
+                                     std::make_pair(std::string("flip z"), std::array<double, 3>{1, 1, -1})}) {
+        auto flipped = make_ramp<PixelType>(nx, ny, nz);
+        flipped->SetSpacing(spacing);
+        typename itk::Image<PixelType, 3>::DirectionType direction;
+        direction.SetIdentity();
+        for (int i = 0; i < 3; ++i) {
+            direction[i][i] = flip[i];
+        }
+        flipped->SetDirection(direction);
+
+        const double t1 = measure([&] { after = panorama::transform_ct_image<PixelType>(flipped, pose); });
+        const std::pair<double, double> diff = difference<PixelType>(before, after);
+
+        // Same index map; only the physical round trip may round differently
+        report("transform (" + name + ")", t0, t1, diff.second <= 1);
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  |diff| mean/max: " << diff.first << "/" << diff.second << std::defaultfloat << std::endl;
+
+        // The view maps indices directly, so the direction cannot change a single value
+        const double t3 = measure([&] { view_after = panorama::TransformedVolume<PixelType>(flipped, pose).materialize(); });
+        report("view (" + name + ")", t2, t3, difference<PixelType>(view_before, view_after, 0).second == 0);
+    }
+}
+
+
+// Load-time crop of mronj: the voxels a posed sampling region reads, from the full volume vs from the volume
+// cropped to the centered hull of the region and its input region (the rotation center stays on the same voxel)
+template <typename PixelType>
+void bench_crop(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 3>::SpacingType spacing;
+    spacing[0] = 0.4;
+    spacing[1] = 0.4;
+    spacing[2] = 0.6;
+    const itk::Matrix<double, 3, 3> pose = panorama::calc_rotation_matrix('z', 7.5);
+
+    std::cout << "[crop] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels" << std::endl;
+
+    auto img = make_volume<PixelType>(nx, ny, nz);
+    img->SetSpacing(spacing);
+
+    // Off-center columns, like the rays of a jaw in the front half of the slab
+    typename itk::Image<PixelType, 3>::RegionType sampling_region;
+    sampling_region.SetIndex({static_cast<long>(nx / 4), static_cast<long>(ny / 8), 0});
+    sampling_region.SetSize({nx / 2, ny / 2, nz});
+
+    const panorama::TransformedVolume<PixelType> posed(img, pose);
+    const typename itk::Image<PixelType, 3>::RegionType input_region = posed.input_region(sampling_region);
+    typename itk::Image<PixelType, 3>::RegionType hull;
+    for (unsigned int i = 0; i < 3; ++i) {
+        const long begin = std::min(sampling_region.GetIndex(i), input_region.GetIndex(i));
+        const long end = std::max(sampling_region.GetIndex(i) + static_cast<long>(sampling_region.GetSize(i)),
+                                  input_region.GetIndex(i) + static_cast<long>(input_region.GetSize(i)));
+        hull.SetIndex(i, begin);
+        hull.SetSize(i, static_cast<std::size_t>(end - begin));
+    }
+
+    typename itk::Image<PixelType, 3>::Pointer before, after;
+    const double t0 = measure([&] { before = posed.region(sampling_region).materialize(); });
+
+    for (const auto& [name, crop_region] : {std::make_pair(std::string("centered"), panorama::calc_centered_region(hull, img->GetLargestPossibleRegion().GetSize())),
+                                            std::make_pair(std::string("hull only"), hull)}) {
+        auto cropped = panorama::crop_image<PixelType>(img, crop_region);
+        typename itk::Image<PixelType, 3>::RegionType region = sampling_region;
+        for (unsigned int i = 0; i < 3; ++i) {
+            region.SetIndex(i, sampling_region.GetIndex(i) - crop_region.GetIndex(i));
+        }
+        const double t1 = measure([&] { after = panorama::TransformedVolume<PixelType>(cropped, pose).region(region).materialize(); });
+        const std::pair<double, double> diff = difference<PixelType>(before, after, 0);
+
+        // Centered: same map up to the rounding of the shifted offset. Hull only: the pivot moves
+        report("rays (" + name + ")", t0, t1, name == "hull only" || diff.second <= 1);
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  kept " << 100.0 * crop_region.GetNumberOfPixels() / img->GetLargestPossibleRegion().GetNumberOfPixels()
+                  << "% of the voxels, |diff| mean/max: " << diff.first << "/" << diff.second << std::defaultfloat << std::endl;
+    }
+}
+
+
+// ROI sweep: extract + axial MIP per range vs one AxialMIPIndex build and a query per range
+template <typename PixelType>
+void bench_mip_index(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    auto img = make_volume<PixelType>(nx, ny, nz);
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> first(0, static_cast<int>(nz) - 1);
+    std::vector<std::pair<short, short>> ranges(32);
+    for (auto& range : ranges) {
+        const short a = static_cast<short>(first(rng));
+        const short b = static_cast<short>(first(rng));
+        range = std::make_pair(std::min(a, b), static_cast<short>(std::max(a, b) + 1));
+    }
+    // Clipping and block edges (default block_slices = 8): whole volume, one slice, ranges reaching
+    // past either end, whole blocks only, one block plus partial ends, and the incomplete last block
+    const short n = static_cast<short>(nz);
+    ranges.insert(ranges.end(), {
+        {0, n}, {0, 1}, {static_cast<short>(n - 1), n}, {-5, 3}, {static_cast<short>(n - 3), static_cast<short>(n + 7)},
+        {0, 8}, {8, 24}, {7, 17}, {9, 15}, {static_cast<short>(n / 8 * 8), n}
+    });
+
+    std::cout << "[mip index] " << nx << "x" << ny << "x" << nz << ", "
+              << sizeof(PixelType) << "-byte pixels, " << ranges.size() << " ranges" << std::endl;
+
+    std::vector<typename itk::Image<PixelType, 2>::Pointer> before(ranges.size()), after(ranges.size());
+    const double t0 = measure([&] {
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            before[i] = panorama::compute_axial_mip_image<PixelType>(panorama::extract_slices<PixelType>(img, ranges[i], true));
+        }
+    });
+    std::size_t memory = 0;
+    const double t1 = measure([&] {
+        const panorama::AxialMIPIndex<PixelType> index(img);
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            after[i] = index.query(ranges[i]);
+        }
+        memory = index.memory_size();
+    });
+
+    bool same = true;
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        same = same && same_image<PixelType>(before[i], after[i]);
+    }
+    report("sweep (incl. build)", t0, t1, same);
+    std::cout << "index " << memory / (1024 * 1024) << " MiB" << std::endl;
+}
+
+
+// Whole volume through the ITK reader only (no mapped / BGZF shortcut)
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer read_with_itk(const std::string& path) {
+    auto reader = itk::ImageFileReader< itk::Image<PixelType, 3> >::New();
+    reader->SetFileName(path);
+    try {
+        reader->Update();
+    } catch (itk::ExceptionObject &err) {
+        std::cerr << "Catch exception: " << std::endl << err << std::endl;
+        return nullptr;
+    }
+    return reader->GetOutput();
+}
+
+
+// Same size and byte-identical voxel buffers
+template <typename PixelType>
+bool same_voxels(const typename itk::Image<PixelType, 3>::Pointer& a, const typename itk::Image<PixelType, 3>::Pointer& b) {
+    if (!a || !b || a->GetLargestPossibleRegion().GetSize() != b->GetLargestPossibleRegion().GetSize()) {
+        return false;
+    }
+    return std::memcmp(a->GetBufferPointer(), b->GetBufferPointer(),
+                       a->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(PixelType)) == 0;
+}
+
+
+// Whole-volume inflate: single gzip stream (zlib) vs BGZF blocks in parallel
+void bench_inflate(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    namespace fs = boost::filesystem;
+
+    auto img = make_volume<short>(nx, ny, nz);
+    const std::size_t bytes = nx * ny * nz * sizeof(short);
+    const fs::path gzip_path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.gz");
+    const fs::path bgzf_path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.bgz");
+
+    std::cout << "[inflate] " << nx << "x" << ny << "x" << nz << ", " << bytes / (1024 * 1024) << " MiB" << std::endl;
+
+    gzFile out = gzopen(gzip_path.string().c_str(), "wb");
+    for (std::size_t pos = 0; pos < bytes; pos += 1 << 30) {
+        const std::size_t n = std::min<std::size_t>(bytes - pos, 1 << 30);
+        gzwrite(out, reinterpret_cast<const char*>(img->GetBufferPointer()) + pos, static_cast<unsigned>(n));
+    }
+    gzclose(out);
+    panorama::convert_to_bgzf(gzip_path.string(), bgzf_path.string());
+
+    std::vector<char> before(bytes), after(bytes);
+    const double t0 = measure([&] {
+        gzFile in = gzopen(gzip_path.string().c_str(), "rb");
+        gzbuffer(in, 1 << 20);
+        std::size_t filled = 0;
+        int n = 0;
+        while (filled < bytes &&
+               (n = gzread(in, before.data() + filled, static_cast<unsigned>(std::min<std::size_t>(bytes - filled, 1 << 30)))) > 0) {
+            filled += static_cast<std::size_t>(n);
+        }
+        gzclose(in);
+    });
+    const double t1 = measure([&] { panorama::inflate_bgzf(bgzf_path.string(), 0, bytes, after.data()); });
+    report("gzip vs bgzf", t0, t1,
+           std::memcmp(before.data(), img->GetBufferPointer(), bytes) == 0 &&
+           std::memcmp(after.data(), img->GetBufferPointer(), bytes) == 0);
+
+    std::cout << "compressed " << fs::file_size(gzip_path) / (1024 * 1024) << " MiB (gzip) vs "
+              << fs::file_size(bgzf_path) / (1024 * 1024) << " MiB (bgzf)" << std::endl;
+
+    // NIfTI round trip: ITK read of the .nii.gz -> convert_to_bgzf -> read_bgzf_nifti_image,
+    // and ITK must still read the converted file
+    const fs::path nifti_path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.nii.gz");
+    const fs::path converted_path = fs::temp_directory_path() / fs::unique_path("%%%%-%%%%.nii.gz");
+    panorama::write_image<short>(img, nifti_path.string());
+    panorama::convert_to_bgzf(nifti_path.string(), converted_path.string());
+
+    const std::pair<short, short> all(0, static_cast<short>(nz));
+    itk::Image<short, 3>::Pointer itk_img, itk_converted, bgzf_img;
+    const double t2 = measure([&] { itk_img = read_with_itk<short>(nifti_path.string()); });
+    const double t3 = measure([&] { bgzf_img = panorama::read_bgzf_nifti_image<short>(converted_path.string(), all); });
+    itk_converted = read_with_itk<short>(converted_path.string());
+    report("nifti: itk (gzip) vs bgzf", t2, t3,
+           same_voxels<short>(img, itk_img) && same_voxels<short>(itk_img, bgzf_img) &&
+           same_voxels<short>(itk_img, itk_converted));
+
+    boost::system::error_code ec;
+    fs::remove(gzip_path, ec);
+    fs::remove(bgzf_path, ec);
+    fs::remove(nifti_path, ec);
+    fs::remove(converted_path, ec);
+}
+
+
+// Masks of a coronal-sized image: PixelType masks vs 8-bit / bit-packed masks
+template <typename PixelType>
+void bench_mask(const std::size_t& nx, const std::size_t& ny, const std::size_t& nz) {
+    typename itk::Image<PixelType, 2>::SizeType size;
+    size[0] = nx;
+    size[1] = nz;
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size);
+
+    // Two noisy bright ellipses (upper and lower jaw) on air
+    auto img = itk::Image<PixelType, 2>::New();
+    img->SetRegions(region);
+    img->Allocate();
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> noise(-200, 200);
+    for (std::size_t y = 0; y < nz; ++y) {
+        for (std::size_t x = 0; x < nx; ++x) {
+            const double u = (x - nx / 2.0) / (nx / 3.0);
+            const double v = (y < nz / 2 ? y - nz / 4.0 : y - 3 * nz / 4.0) / (nz / 5.0);
+            img->GetBufferPointer()[y * nx + x] = static_cast<PixelType>((u * u + v * v < 1 ? 1500 : -1000) + noise(rng));
+        }
+    }
+    const PixelType threshold = 1000;
+
+    std::cout << "[mask] " << nx << "x" << nz << ", " << sizeof(PixelType) << "-byte pixels, mask "
+              << nx * nz * sizeof(PixelType) / 1024 << " KiB -> " << nx * nz / 1024 << " KiB (8-bit), "
+              << (nx + 63) / 64 * 8 * nz / 1024 << " KiB (bits)" << std::endl;
+
+    // Same pixels set (legacy masks that are returned unprocessed hold `threshold` instead of 255)
+    auto same_mask = [&](const typename itk::Image<PixelType, 2>::Pointer& a, const panorama::MaskImage::Pointer& b) {
+        for (std::size_t i = 0; i < nx * nz; ++i) {
+            if ((a->GetBufferPointer()[i] != 0) != (b->GetBufferPointer()[i] != 0)) return false;
+        }
+        return true;
+    };
+
+    std::vector<short> hist_before, hist_after;
+    double t0 = measure([&] {
+        hist_before = panorama::compute_horizontal_histogram<PixelType>(panorama::compute_mask_image<PixelType>(img, threshold), threshold);
+    });
+    double t1 = measure([&] {
+        hist_after = panorama::compute_horizontal_histogram(panorama::compute_bit_mask<PixelType>(img, threshold));
+    });
+    report("horizontal histogram", t0, t1, hist_before == hist_after);
+
+    typename itk::Image<PixelType, 2>::Pointer jaw_before;
+    panorama::MaskImage::Pointer jaw_after;
+    t0 = measure([&] { jaw_before = panorama::process_jaw_mask<PixelType>(panorama::compute_mask_image<PixelType>(img, threshold)); });
+    t1 = measure([&] { jaw_after = panorama::process_jaw_mask<unsigned char>(panorama::compute_binary_mask<PixelType>(img, threshold)); });
+    report("jaw mask", t0, t1, same_mask(jaw_before, jaw_after));
+
+    typename itk::Image<PixelType, 2>::Pointer tooth_before;
+    panorama::MaskImage::Pointer tooth_after;
+    t0 = measure([&] { tooth_before = panorama::process_tooth_mask<PixelType>(panorama::compute_mask_image<PixelType>(img, threshold)); });
+    t1 = measure([&] { tooth_after = panorama::process_tooth_mask<unsigned char>(panorama::compute_binary_mask<PixelType>(img, threshold)); });
+    report("tooth mask", t0, t1, same_mask(tooth_before, tooth_after));
+}
+
+
+/**
+ * Benchmark entry
+ *
+ * usage: bench [mip|orthogonal|mip_index|view|direction|resample|shear|region|crop|pixel_type|inflate|mask] [nx ny nz]
+ */
+int main(int argc, char** argv) {
+    const std::string target = argc > 1 ? argv[1] : "mip";
+    const std::size_t nx = argc > 4 ? std::stoul(argv[2]) : 512;
+    const std::size_t ny = argc > 4 ? std::stoul(argv[3]) : 512;
+    const std::size_t nz = argc > 4 ? std::stoul(argv[4]) : 400;
+
+    std::cout << std::left << std::setw(24) << "kernel"
+              << std::right << std::setw(15) << "before"
+              << std::setw(15) << "after"
+              << std::setw(11) << "speedup" << std::endl;
+
+    if (target == "mip") {
+        bench_mip<double>(nx, ny, nz);
+        bench_mip<short>(nx, ny, nz);
+    } else if (target == "orthogonal") {
+        bench_orthogonal<double>(nx, ny, nz);
+        bench_orthogonal<short>(nx, ny, nz);
+    } else if (target == "mip_index") {
+        bench_mip_index<double>(nx, ny, nz);
+        bench_mip_index<short>(nx, ny, nz);
+    } else if (target == "view") {
+        bench_view<double>(nx, ny, nz);
+        bench_view<short>(nx, ny, nz);
+    } else if (target == "direction") {
+        bench_direction<double>(nx, ny, nz);
+        bench_direction<short>(nx, ny, nz);
+    } else if (target == "resample") {
+        bench_resample<double>(nx, ny, nz);
+        bench_resample<short>(nx, ny, nz);
+    } else if (target == "shear") {
+        bench_shear<double>(nx, ny, nz);
+        bench_shear<short>(nx, ny, nz);
+    } else if (target == "region") {
+        bench_region<double>(nx, ny, nz);
+        bench_region<short>(nx, ny, nz);
+    } else if (target == "crop") {
+        bench_crop<double>(nx, ny, nz);
+        bench_crop<short>(nx, ny, nz);
+    } else if (target == "pixel_type") {
+        bench_pixel_type(nx, ny, nz);
+    } else if (target == "inflate") {
+        bench_inflate(nx, ny, nz);
+    } else if (target == "mask") {
+        bench_mask<double>(nx, ny, nz);
+        bench_mask<short>(nx, ny, nz);
+    } else {
+        std::cerr << "Unknown benchmark: " << target << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
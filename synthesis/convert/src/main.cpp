@@ -0,0 +1,34 @@
+#include <iostream>
+#include <string>
+
+#include <image/bgzf.hpp>
+
+
+/**
+ * Rewrite gzip-compressed volumes as BGZF in place, so they can be inflated in parallel.
+ * The files stay valid .nii.gz for every other reader.
+ *
+ * usage: convert file.nii.gz [file.nii.gz ...]
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: convert file.nii.gz [file.nii.gz ...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int i = 1; i < argc; ++i) {
+        const std::string path = argv[i];
+        if (panorama::is_bgzf(path)) {
+            std::cout << path << ": already BGZF" << std::endl;
+            continue;
+        }
+        if (panorama::convert_to_bgzf(path, path)) {
+            std::cout << path << ": converted" << std::endl;
+        } else {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
@@ -4,6 +4,8 @@
 
 #include <itkImage.h>
 
+#include "../image/mask.hpp"
+
 namespace panorama {
     template <typename PixelType>
     std::vector<short>
@@ -15,6 +17,10 @@ namespace panorama {
     template <typename PixelType>
     std::vector<short> 
     compute_horizontal_histogram(const typename itk::Image<PixelType, 2>::Pointer&, const PixelType&);
+
+    // Set pixels per row (popcount), same smoothing as above
+    std::vector<short>
+    compute_horizontal_histogram(const BitMask&);
     
     std::vector<short>
     compute_horizontal_curve(const std::vector<short>&);
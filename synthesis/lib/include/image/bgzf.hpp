@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+namespace panorama {
+    /*
+     * BGZF: gzip made of independently compressed members of at most 64 KiB, each carrying its
+     * compressed size in a "BC" extra field. Any gzip reader (ITK, zlib) still reads the file as
+     * one stream, while the block table lets the members be inflated in parallel or at random.
+     */
+
+    // gzip file whose first member carries the BGZF "BC" field
+    bool is_bgzf(const std::string&);
+
+    // Uncompressed bytes [begin, begin + length) of a BGZF file -> out, blocks inflated in parallel.
+    // false if the file is not BGZF, is corrupt or shorter than requested.
+    bool inflate_bgzf(const std::string&, const std::size_t& begin, const std::size_t& length, char* out);
+
+    // Uncompressed size of a BGZF file (0 if not BGZF)
+    std::size_t bgzf_size(const std::string&);
+
+    // Any gzip (or plain) file -> BGZF, blocks compressed in parallel.
+    // dst may equal src: the output is written to a temporary file and renamed.
+    bool convert_to_bgzf(const std::string& src, const std::string& dst, const int& level = 6);
+}
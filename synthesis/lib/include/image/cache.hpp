@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <itkImage.h>
+
+
+namespace panorama {
+    // Fingerprint of an input file (hex): modification time, size and 64 KiB samples spread over it
+    // (head, tail and evenly spaced), so unchanged inputs are recognised without reading them whole.
+    // Any rewrite of the file changes it; a copy or a remount that keeps the mtime does not.
+    std::string fingerprint_file(const std::string&);
+
+    /*
+     * On-disk cache of intermediate volumes.
+     * An entry holds a small header (pixel type, size, spacing, origin, direction and a few
+     * per-stage values such as thresholds or slice ranges) followed by zlib-compressed chunks of
+     * `chunk_slices` z-slices, compressed and inflated in parallel.
+     * Entries are named by a hash of the input fingerprint, the stage name and its parameters, so a
+     * change in either simply misses. Corrupt or foreign entries are treated as misses too.
+     */
+    class VolumeCache {
+    private:
+        std::string dir;
+        int chunk_slices;
+        int level;
+
+    public:
+        explicit VolumeCache(const std::string& dir, const int& chunk_slices = 16, const int& level = 1);
+
+        // Entry path for a stage of an input
+        std::string key(const std::string& fingerprint, const std::string& stage, const std::string& params) const;
+
+        // nullptr on a miss
+        template <typename PixelType>
+        typename itk::Image<PixelType, 3>::Pointer
+        load(const std::string& key, std::vector<double>& values) const;
+
+        template <typename PixelType>
+        bool store(const std::string& key, const typename itk::Image<PixelType, 3>::Pointer&,
+                   const std::vector<double>& values = {}) const;
+    };
+}
@@ -1,28 +1,114 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <limits>
+#include <utility>
 
 #include <itkImage.h>
 
+#include "resample.hpp"
+
 namespace panorama {
     constexpr int HU_MIN = -1024;
     constexpr int HU_MAX = 3071;
+    constexpr int HU_AIR = -500;        // above: tissue, bone, the table
+
+    // Clamp a single value to [HU_MIN, HU_MAX]
+    template <typename PixelType>
+    inline PixelType clamp_hu(const PixelType& value) {
+        return std::min(std::max(value, static_cast<PixelType>(HU_MIN)), static_cast<PixelType>(HU_MAX));
+    }
     
+    // Isotropic resampling to the x spacing (resample_image); an isotropic volume is returned as is
     template <typename PixelType>
     typename itk::Image<PixelType, 3>::Pointer
-    resampling_ct_image(const typename itk::Image<PixelType, 3>::Pointer&);
+    resampling_ct_image(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const ResampleKernel& kernel = ResampleKernel::Linear
+    );
     
+    // Clamp to [HU_MIN, HU_MAX]. Both leave the volume at origin 0 with identity direction
+    // (spacing kept), the index-aligned geometry the stages after windowing work in
     template <typename PixelType>
     typename itk::Image<PixelType, 3>::Pointer
     window_ct_image(const typename itk::Image<PixelType, 3>::Pointer&);
+
+    template <typename PixelType>
+    void window_ct_image_inplace(const typename itk::Image<PixelType, 3>::Pointer&);
     
+    // Slices [first, second) with the origin on the first one. By default a view sharing the parent buffer
+    // (the parent's pixels stay alive with it, writes show in both); copy: a separate volume
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    extract_slices(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const std::pair<short, short>&,
+        const bool& copy = false
+    );
+
+    // Bounding box of the voxels above threshold, from every step-th voxel along each axis, grown by
+    // margin voxels (plus the sampling gap) and clipped to the image; the whole image if no voxel passes
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::RegionType
+    calc_head_region(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const PixelType& threshold = HU_AIR,
+        const std::size_t& step = 4,
+        const std::size_t& margin = 8
+    );
+
+    // Smallest region holding region that is centered in an image of the given size (same margin on both
+    // sides of each axis), so a crop to it keeps the continuous index size / 2 on the same voxel
+    itk::ImageRegion<3> calc_centered_region(const itk::ImageRegion<3>&, const itk::Size<3>&);
+
+    // Copy of an index region; the origin moves to its first voxel, so physical coordinates are kept
     template <typename PixelType>
     typename itk::Image<PixelType, 3>::Pointer
-    extract_slices(const typename itk::Image<PixelType, 3>::Pointer&, const std::pair<short, short>&);
+    crop_image(const typename itk::Image<PixelType, 3>::Pointer&, const typename itk::Image<PixelType, 3>::RegionType&);
     
     template <typename PixelType>
     typename itk::Image<PixelType, 3>::Pointer
     rotate_ct_image(const typename itk::Image<PixelType, 3>::Pointer&, const char&, const double&);
+
+    // Tilt corrections are accumulated as pose = pose * calc_rotation_matrix(axis, angle)
+    // and applied once by transform_ct_image (optionally cropped to a slice range)
+    itk::Matrix<double, 3, 3> calc_rotation_matrix(const char&, const double&);
+
+    // Resample: one trilinear resampling (ITK); Shear: three 1-D shear passes (shear_transform_ct_image)
+    // when the pose rotates about a single index axis, resampling otherwise
+    enum class RotationEngine { Resample, Shear };
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    transform_ct_image(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const itk::Matrix<double, 3, 3>&,
+        const std::pair<short, short>& range = {0, std::numeric_limits<short>::max()},
+        const RotationEngine& engine = RotationEngine::Resample
+    );
+
+    // Same rotation, producing only the output voxels in region (an index region of the input grid,
+    // clipped to it); the result starts at index 0 with its origin on the region's first voxel
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    transform_ct_image(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const itk::Matrix<double, 3, 3>&,
+        const typename itk::Image<PixelType, 3>::RegionType&,
+        const RotationEngine& engine = RotationEngine::Resample
+    );
+
+    // Index region of the image grid holding every voxel whose center lies in the physical box [lower, upper] (mm):
+    // exactly those voxels when the grid axes are parallel to the physical ones, the index bounding box of the
+    // box corners on oblique grids. Drivers build their regions in index space directly; this is for boxes in mm.
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::RegionType
+    calc_output_region(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const itk::Point<double, 3>&,
+        const itk::Point<double, 3>&
+    );
     /*
     template <typename PixelType>
     typename itk::image<PixelType, 2>::Pointer
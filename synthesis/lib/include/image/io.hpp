@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <utility>
 
 #include <itkImage.h>
 
@@ -9,9 +10,17 @@ namespace panorama {
     template <typename PixelType, int DIM=3>
     typename itk::Image<PixelType, DIM>::Pointer
     read_image(const std::string&);
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    read_image_region(const std::string&, const std::pair<short, short>&);
+
+    template <typename PixelType>
+    std::array<size_t, 3>
+    read_image_size(const std::string&);
     
     template <typename PixelType, int DIM=3>
-    void write_image(
+    bool write_image(
         const typename itk::Image<PixelType, DIM>::Pointer&,
         const std::string&
     );
@@ -1,14 +1,65 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include <itkImage.h>
+#include <opencv2/opencv.hpp>
 
 namespace panorama {
+    // 8-bit mask: 255 inside, 0 outside (the CV_8UC1 layout OpenCV contours work on)
+    using MaskImage = itk::Image<unsigned char, 2>;
+
+    // Bit-packed mask, one bit per pixel; rows start on a word boundary (bit x % 64 of word x / 64)
+    struct BitMask {
+        std::size_t width = 0;
+        std::size_t height = 0;
+        std::size_t words_per_row = 0;
+        std::vector<std::uint64_t> words;
+
+        const std::uint64_t* row(const std::size_t& y) const {
+            return words.data() + y * words_per_row;
+        }
+
+        bool test(const std::size_t& x, const std::size_t& y) const {
+            return (row(y)[x / 64] >> (x % 64)) & 1;
+        }
+
+        // Set pixels in row y
+        std::size_t count_row(const std::size_t& y) const {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < words_per_row; ++i) {
+                count += static_cast<std::size_t>(__builtin_popcountll(row(y)[i]));
+            }
+            return count;
+        }
+    };
+
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer
     compute_mask_image(const typename itk::Image<PixelType, 2>::Pointer&, const PixelType&);
 
+    // Pixels > threshold -> 8-bit mask with the geometry of the image
+    template <typename PixelType>
+    MaskImage::Pointer
+    compute_binary_mask(const typename itk::Image<PixelType, 2>::Pointer&, const PixelType&);
+
+    // Pixels > threshold -> bit-packed mask
+    template <typename PixelType>
+    BitMask
+    compute_bit_mask(const typename itk::Image<PixelType, 2>::Pointer&, const PixelType&);
+
+    BitMask
+    pack_mask(const MaskImage::Pointer&);
+
+    // Mask image -> CV_8UC1 binary (255 where set). 8-bit masks are thresholded at 0 in one pass;
+    // other pixel types are saturated to 8 bits and binarized with Otsu's method.
+    template <typename PixelType>
+    cv::Mat
+    binarize_mask(const typename itk::Image<PixelType, 2>::Pointer&);
+
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer
     process_jaw_mask(const typename itk::Image<PixelType, 2>::Pointer&);
@@ -16,4 +67,4 @@ namespace panorama {
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer
     process_tooth_mask(const typename itk::Image<PixelType, 2>::Pointer&);
-}
\ No newline at end of file
+}
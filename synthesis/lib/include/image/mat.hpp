@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+
+#include <itkImage.h>
+#include <itkImportImageContainer.h>
+#include <opencv2/opencv.hpp>
+
+#include "pool.hpp"
+
+
+namespace panorama {
+    // OpenCV type of a single-channel PixelType image
+    template <typename PixelType>
+    inline int cv_type() {
+        return CV_MAKETYPE(cv::DataType<PixelType>::depth, 1);
+    }
+
+    // 2D itkImage -> cv::Mat header over the image buffer (no copy).
+    // The Mat is valid while the image lives and writes through it modify the image.
+    template <typename PixelType>
+    inline cv::Mat as_mat(const typename itk::Image<PixelType, 2>::Pointer& img) {
+        const typename itk::Image<PixelType, 2>::SizeType size = img->GetBufferedRegion().GetSize();
+        return cv::Mat(static_cast<int>(size[1]), static_cast<int>(size[0]), cv_type<PixelType>(),
+                       const_cast<PixelType*>(img->GetBufferPointer()), size[0] * sizeof(PixelType));
+    }
+
+
+    // Pixel container sharing the data of a cv::Mat, kept alive by the Mat reference count
+    template <typename TElementIdentifier, typename TElement>
+    class MatImageContainer : public itk::ImportImageContainer<TElementIdentifier, TElement> {
+    public:
+        ITK_DISALLOW_COPY_AND_MOVE(MatImageContainer);
+
+        using Self = MatImageContainer;
+        using Superclass = itk::ImportImageContainer<TElementIdentifier, TElement>;
+        using Pointer = itk::SmartPointer<Self>;
+        using ConstPointer = itk::SmartPointer<const Self>;
+
+        itkNewMacro(Self);
+
+        void SetMat(const cv::Mat& mat) {
+            m_Mat = mat;
+        }
+
+    protected:
+        MatImageContainer() = default;
+        ~MatImageContainer() override = default;
+
+    private:
+        cv::Mat m_Mat;
+    };
+
+
+    // Single-channel cv::Mat -> 2D itkImage with the geometry of `reference` (if given).
+    // A continuous Mat of PixelType is shared without a copy (later drawing on the Mat shows in
+    // the image); other types or strides are converted in one pass into the image buffer.
+    template <typename PixelType>
+    inline typename itk::Image<PixelType, 2>::Pointer
+    as_image(const cv::Mat& mat, const typename itk::Image<PixelType, 2>::Pointer& reference = nullptr) {
+        using ImageType = itk::Image<PixelType, 2>;
+
+        typename ImageType::SizeType size;
+        size[0] = static_cast<itk::SizeValueType>(mat.cols);
+        size[1] = static_cast<itk::SizeValueType>(mat.rows);
+        typename ImageType::RegionType region;
+        region.SetSize(size);
+
+        auto img = ImageType::New();
+        img->SetRegions(region);
+        if (reference) {
+            img->SetSpacing(reference->GetSpacing());
+            img->SetOrigin(reference->GetOrigin());
+            img->SetDirection(reference->GetDirection());
+        }
+
+        if (mat.type() == cv_type<PixelType>() && mat.isContinuous()) {
+            auto container = MatImageContainer<itk::SizeValueType, PixelType>::New();
+            container->SetImportPointer(reinterpret_cast<PixelType*>(mat.data), mat.total(), false);
+            container->SetMat(mat);
+            img->SetPixelContainer(container);
+        } else {
+            allocate_image<PixelType, 2>(img);
+            cv::Mat view = as_mat<PixelType>(img);
+            mat.convertTo(view, view.type());
+        }
+        return img;
+    }
+}
@@ -1,23 +1,75 @@
 #pragma once
 
 #include <array>
+#include <utility>
+#include <vector>
 
 #include <itkImage.h>
 
+#include "view.hpp"
 
+
+// clamp: window the projection to [HU_MIN, HU_MAX] while reading, so an unwindowed
+// volume gives the same result as window_ct_image followed by the MIP
 namespace panorama {
+    // Axial, coronal and sagittal MIPs plus the global max of one volume
+    template <typename PixelType>
+    struct OrthogonalMIPs {
+        typename itk::Image<PixelType, 2>::Pointer axial;
+        typename itk::Image<PixelType, 2>::Pointer coronal;
+        typename itk::Image<PixelType, 2>::Pointer sagittal;
+        PixelType max_value;
+    };
+
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer 
-    compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&);
+    compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&, const bool& clamp = false);
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Pointer&, const bool& clamp = false);
+
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&, const bool& clamp = false); 
 
+    // MIPs of a posed volume read through the view (only the voxels each projection needs are interpolated)
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer
-    compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Pointer&);
+    compute_axial_mip_image(const TransformedVolume<PixelType>&, const bool& clamp = false);
 
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer
-    compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Pointer&); 
+    compute_sagittal_mip_image(const TransformedVolume<PixelType>&, const bool& clamp = false);
+
+    template <typename PixelType>
+    PixelType get_max_pixel_value(const typename itk::Image<PixelType, 3>::Pointer&, const bool& clamp = false);
+
+    template <typename PixelType>
+    OrthogonalMIPs<PixelType> compute_orthogonal_mips(const typename itk::Image<PixelType, 3>::Pointer&, const bool& clamp = false);
 
+    // Range-max index over z for repeated axial MIPs of one volume.
+    // Slices are grouped into blocks of block_slices; a sparse table over the block maxima answers
+    // the whole blocks of a range and the partial blocks at both ends are read from the volume,
+    // so query() reads at most 2 * block_slices planes for any range (build ~2 passes over the volume,
+    // memory about log2(blocks) / block_slices of the volume).
     template <typename PixelType>
-    PixelType get_max_pixel_value(const typename itk::Image<PixelType, 3>::Pointer&);
-}
\ No newline at end of file
+    class AxialMIPIndex {
+    public:
+        explicit AxialMIPIndex(const typename itk::Image<PixelType, 3>::Pointer&, const std::size_t& block_slices = 8);
+
+        // Axial MIP of slices [first, second), clipped to the volume like extract_slices
+        typename itk::Image<PixelType, 2>::Pointer
+        query(const std::pair<short, short>&, const bool& clamp = false) const;
+
+        std::size_t memory_size() const;
+
+    private:
+        typename itk::Image<PixelType, 3>::Pointer img;
+        std::size_t nx, ny, nz, plane;
+        std::size_t block_slices;
+        std::size_t block_num;
+        // table[k][b * plane + i]: max of pixel i over blocks [b, b + 2^k)
+        std::vector<std::vector<PixelType>> table;
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <utility>
+
+#include <itkImage.h>
+
+
+namespace panorama {
+    // Storage fields of a NIfTI-1 header (geometry is left to ITK)
+    struct NiftiHeader {
+        std::array<std::size_t, 3> size;    // dim[1..3]
+        std::array<double, 3> spacing;      // pixdim[1..3]
+        short datatype;                     // NIFTI_TYPE_* code
+        short bitpix;                       // bits per voxel
+        std::size_t vox_offset;             // byte offset of voxel data
+        float scl_slope;                    // value = scl_slope * stored + scl_inter
+        float scl_inter;
+        bool swapped;                       // written with the other byte order
+    };
+
+    bool is_uncompressed_nifti(const std::string&);
+    bool is_compressed_nifti(const std::string&);
+
+    // Parse the 348-byte NIfTI-1 header of a .nii or .nii.gz file (only the header is inflated);
+    // false if not a NIfTI-1 file
+    bool read_nifti_header(const std::string&, NiftiHeader&);
+
+    // Map slices [first, second) of an uncompressed .nii file without copying.
+    // nullptr when the file cannot be mapped as PixelType (datatype, scaling, byte order),
+    // callers then fall back to the ITK reader.
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    map_nifti_image(const std::string&, const std::pair<short, short>&);
+
+    // Read slices [first, second) of a BGZF-compressed .nii.gz, inflating only the blocks holding them
+    // (in parallel). nullptr when the file is plain gzip or not stored as PixelType; callers then
+    // fall back to the ITK reader.
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    read_bgzf_nifti_image(const std::string&, const std::pair<short, short>&);
+
+    // .nii.gz -> <cache_dir>/<name>.nii, decompressed once (in parallel for BGZF) and reused while newer than the source.
+    // Other paths are returned unchanged.
+    std::string cache_nifti(const std::string&, const std::string&);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+#include <itkImage.h>
+#include <itkImportImageContainer.h>
+
+
+namespace panorama {
+    /*
+     * Size-bucketed pool of large image buffers.
+     * Buffers are anonymous mappings advised for transparent huge pages; sizes are rounded up to
+     * size classes (a quarter of the next power of two, at least 2 MiB) so volumes of similar
+     * size share buckets. Released buffers are kept for reuse up to `limit` bytes, the rest is
+     * returned to the system. Buffers are not cleared between uses.
+     */
+    class BufferPool {
+    private:
+        std::mutex mutex;
+        std::multimap<std::size_t, void*> buffers;     // capacity -> free buffer
+        std::size_t cached = 0;
+        std::size_t limit = std::size_t(4) << 30;
+
+        BufferPool() = default;
+
+    public:
+        // Images smaller than this are allocated by ITK as usual
+        static constexpr std::size_t MIN_BYTES = std::size_t(1) << 20;
+
+        static BufferPool& instance();
+        ~BufferPool();
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // nullptr if no memory could be mapped; capacity receives the bucket size
+        void* acquire(const std::size_t& bytes, std::size_t& capacity);
+        void release(void* buffer, const std::size_t& capacity);
+
+        void set_limit(const std::size_t&);
+        std::size_t cached_bytes();
+        // Return every cached buffer to the system
+        void trim();
+    };
+
+
+    // Pixel container over a pool buffer, handed back to the pool with the container
+    template <typename TElementIdentifier, typename TElement>
+    class PooledImageContainer : public itk::ImportImageContainer<TElementIdentifier, TElement> {
+    public:
+        ITK_DISALLOW_COPY_AND_MOVE(PooledImageContainer);
+
+        using Self = PooledImageContainer;
+        using Superclass = itk::ImportImageContainer<TElementIdentifier, TElement>;
+        using Pointer = itk::SmartPointer<Self>;
+        using ConstPointer = itk::SmartPointer<const Self>;
+
+        itkNewMacro(Self);
+
+        void SetPoolBuffer(void* buffer, const std::size_t& capacity) {
+            m_Buffer = buffer;
+            m_Capacity = capacity;
+        }
+
+    protected:
+        PooledImageContainer() = default;
+        ~PooledImageContainer() override {
+            if (m_Buffer) {
+                BufferPool::instance().release(m_Buffer, m_Capacity);
+            }
+        }
+
+    private:
+        void* m_Buffer = nullptr;
+        std::size_t m_Capacity = 0;
+    };
+
+
+    // Pixel container over part of another container's buffer, which it keeps alive
+    template <typename TElementIdentifier, typename TElement>
+    class SharedImageContainer : public itk::ImportImageContainer<TElementIdentifier, TElement> {
+    public:
+        ITK_DISALLOW_COPY_AND_MOVE(SharedImageContainer);
+
+        using Self = SharedImageContainer;
+        using Superclass = itk::ImportImageContainer<TElementIdentifier, TElement>;
+        using Pointer = itk::SmartPointer<Self>;
+        using ConstPointer = itk::SmartPointer<const Self>;
+
+        itkNewMacro(Self);
+
+        void SetParent(Superclass* parent) {
+            m_Parent = parent;
+        }
+
+    protected:
+        SharedImageContainer() = default;
+        ~SharedImageContainer() override = default;
+
+    private:
+        typename Superclass::Pointer m_Parent;
+    };
+
+
+    // img->Allocate() drawing the buffer of large images from the pool (regions must be set)
+    template <typename PixelType, int DIM>
+    void allocate_image(const typename itk::Image<PixelType, DIM>::Pointer& img) {
+        const std::size_t pixels = img->GetBufferedRegion().GetNumberOfPixels();
+        const std::size_t bytes = pixels * sizeof(PixelType);
+
+        std::size_t capacity = 0;
+        void* buffer = bytes >= BufferPool::MIN_BYTES ? BufferPool::instance().acquire(bytes, capacity) : nullptr;
+        if (!buffer) {
+            img->Allocate();
+            return;
+        }
+
+        auto container = PooledImageContainer<itk::SizeValueType, PixelType>::New();
+        container->SetImportPointer(static_cast<PixelType*>(buffer), pixels, false);
+        container->SetPoolBuffer(buffer, capacity);
+        img->SetPixelContainer(container);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <itkImage.h>
+
+
+namespace panorama {
+    // Linear: same values as ITK's linear interpolator; Cubic: Catmull-Rom (Keys, a = -0.5);
+    // Box: mean of the input voxels covered by each output voxel (anti-aliased downsampling,
+    // linear along axes that are not shrunk)
+    enum class ResampleKernel { Linear, Cubic, Box };
+
+    /*
+     * Resample to a new spacing on the same origin and direction (the grid of ResampleImageFilter:
+     * output voxel i lies on input index i * spacing / input spacing, 0 outside, size = size * input spacing / spacing).
+     * The kernel is separable, so the volume is resampled in three 1-D passes with per-axis weight tables:
+     * x and y plane by plane, then z over slabs of output slices. Only the input planes a slab reads are
+     * kept (a ring of resampled planes), so the working set stays bounded whatever the volume depth.
+     */
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    resample_image(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const typename itk::Image<PixelType, 3>::SpacingType&,
+        const ResampleKernel& kernel = ResampleKernel::Linear
+    );
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <itkImage.h>
+
+
+namespace panorama {
+    /*
+     * Pose that rotates about one index axis (a single tilt, or tilts about the same axis composed)
+     * as three 1-D shear passes per plane (Paeth). Same geometry as transform_ct_image (rotation about
+     * the volume center, output voxels of region on the input grid, 0 outside); the index-space rotation
+     * of each plane is split into shear(a) * shear(b) * shear(a), and every pass shifts whole rows by one
+     * offset and one linear weight. Values differ from trilinear resampling by the interpolation only.
+     * nullptr when the pose does not split (no tilt, more than one axis, oblique directions).
+     */
+    template <typename PixelType>
+    typename itk::Image<PixelType, 3>::Pointer
+    shear_transform_ct_image(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const itk::Matrix<double, 3, 3>&,
+        const typename itk::Image<PixelType, 3>::RegionType&
+    );
+}
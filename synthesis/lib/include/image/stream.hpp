@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include <itkImage.h>
+
+#include "mip.hpp"
+
+
+namespace panorama {
+    // Coronal MIP of a volume file, read `slab` slices at a time so the full volume is never resident.
+    // Only .nii and BGZF files are streamed; other files (plain gzip) are read in one sequential pass.
+    // clamp: window to [HU_MIN, HU_MAX] on read (the volume is not windowed beforehand)
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer
+    compute_coronal_mip_image(const std::string&, const short& slab = 32, const bool& clamp = true);
+
+    // Axial, coronal and sagittal MIPs plus the global max of a volume file, streamed the same way
+    // (one read of the file; all members are nullptr if it cannot be read)
+    template <typename PixelType>
+    OrthogonalMIPs<PixelType>
+    compute_orthogonal_mips(const std::string&, const short& slab = 32, const bool& clamp = true);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include <itkImage.h>
+
+
+namespace panorama {
+    /*
+     * Read-only view of a volume under a pose, sampled on access instead of resampled up front.
+     * Same geometry as transform_ct_image: rotation about the center of the full volume, output grid =
+     * input grid restricted to slices [range.first, range.second), linear interpolation, 0 outside.
+     * Output index (x, y, z) maps affinely to an input continuous index, so consumers read only the voxels
+     * they need; materialize() samples the same way, so sampled and resampled values agree exactly.
+     * The view keeps the volume alive.
+     */
+    template <typename PixelType>
+    class TransformedVolume {
+    public:
+        using ImageType = itk::Image<PixelType, 3>;
+
+        TransformedVolume(
+            const typename ImageType::Pointer&,
+            const itk::Matrix<double, 3, 3>&,
+            const std::pair<short, short>& range = {0, std::numeric_limits<short>::max()}
+        );
+
+        // Output slices [first, second) of this view (relative to its first slice, clipped like extract_slices)
+        TransformedVolume slices(const std::pair<short, short>&) const;
+
+        // Output voxels in region (an index region of this view, clipped to it); index 0 of the result is
+        // the region's first voxel, so materialize() resamples only the region
+        TransformedVolume region(const typename ImageType::RegionType&) const;
+
+        // Index region of the input read by the output voxels in region (the interpolation neighbours of
+        // its mapped corners, clipped to the input); empty if region is empty
+        typename ImageType::RegionType input_region(const typename ImageType::RegionType&) const;
+
+        // Resampled copy of the view (what transform_ct_image returns for the same pose and range)
+        typename ImageType::Pointer materialize() const;
+
+        const typename ImageType::SizeType& size() const { return output_size; }
+        const typename ImageType::Pointer& image() const { return img; }
+
+        // Input continuous index of output index (x, y, z)
+        void map(const double& x, const double& y, const double& z, double* index) const {
+            for (int i = 0; i < 3; ++i) {
+                index[i] = offset[i] + matrix[i][0] * x + matrix[i][1] * y + matrix[i][2] * z;
+            }
+        }
+
+        // Linear interpolation at an input continuous index, edge voxels clamped as in ITK,
+        // 0 outside [-0.5, size - 0.5); cast like the resampler (clamped to the pixel range, truncated)
+        PixelType interpolate(const double* index) const {
+            long base[3];
+            double frac[3];
+            for (int i = 0; i < 3; ++i) {
+                if (!(index[i] >= -0.5 && index[i] < static_cast<double>(input_size[i]) - 0.5)) {
+                    return 0;
+                }
+                const double f = std::floor(index[i]);
+                base[i] = static_cast<long>(f);
+                frac[i] = index[i] - f;
+            }
+
+            const long x0 = std::max(base[0], 0L), x1 = std::min(base[0] + 1, static_cast<long>(input_size[0]) - 1);
+            const long y0 = std::max(base[1], 0L), y1 = std::min(base[1] + 1, static_cast<long>(input_size[1]) - 1);
+            const long z0 = std::max(base[2], 0L), z1 = std::min(base[2] + 1, static_cast<long>(input_size[2]) - 1);
+            const long sx = static_cast<long>(input_size[0]);
+            const long sxy = sx * static_cast<long>(input_size[1]);
+
+            const PixelType* p00 = buffer + z0 * sxy + y0 * sx;
+            const PixelType* p01 = buffer + z0 * sxy + y1 * sx;
+            const PixelType* p10 = buffer + z1 * sxy + y0 * sx;
+            const PixelType* p11 = buffer + z1 * sxy + y1 * sx;
+
+            const double c00 = p00[x0] + frac[0] * (static_cast<double>(p00[x1]) - p00[x0]);
+            const double c01 = p01[x0] + frac[0] * (static_cast<double>(p01[x1]) - p01[x0]);
+            const double c10 = p10[x0] + frac[0] * (static_cast<double>(p10[x1]) - p10[x0]);
+            const double c11 = p11[x0] + frac[0] * (static_cast<double>(p11[x1]) - p11[x0]);
+            const double c0 = c00 + frac[1] * (c01 - c00);
+            const double c1 = c10 + frac[1] * (c11 - c10);
+            const double value = c0 + frac[2] * (c1 - c0);
+
+            if (std::is_integral<PixelType>::value) {
+                return static_cast<PixelType>(std::min(std::max(value, static_cast<double>(std::numeric_limits<PixelType>::lowest())),
+                                                       static_cast<double>(std::numeric_limits<PixelType>::max())));
+            }
+            return static_cast<PixelType>(value);
+        }
+
+        PixelType sample(const double& x, const double& y, const double& z) const {
+            double index[3];
+            map(x, y, z, index);
+            return interpolate(index);
+        }
+
+    private:
+        typename ImageType::Pointer img;
+        const PixelType* buffer;
+        typename ImageType::SizeType input_size;
+        typename ImageType::SizeType output_size;
+        typename ImageType::IndexType first;    // first output voxel in the input grid
+        double matrix[3][3];                    // output index -> input continuous index (linear part)
+        double offset[3];                       // input continuous index of output index (0, 0, 0)
+    };
+}
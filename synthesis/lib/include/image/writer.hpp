@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <itkImage.h>
+#include <opencv2/opencv.hpp>
+
+#include "io.hpp"
+
+
+namespace panorama {
+    /*
+     * Asynchronous artifact writer.
+     * A small pool of threads encodes and writes finished images off the compute threads.
+     * Submitted images are owned by the writer (ITK / cv::Mat reference counts); they must
+     * not be modified after submission. Submission blocks while `max_queue` jobs are waiting.
+     * The destructor drains the queue and prints a summary (files, failures, latency, queue depth);
+     * verbose additionally reports each file's latency (submit -> written) and queue depth at submission.
+     */
+    class AsyncWriter {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Job {
+            std::string path;
+            std::function<void()> write;
+            Clock::time_point submitted;
+            std::size_t depth;
+        };
+
+        std::size_t max_queue;
+        bool verbose;
+
+        std::mutex mutex;
+        std::condition_variable queued;     // a job is waiting (or stopping)
+        std::condition_variable taken;      // room in the queue / a job finished
+        std::deque<Job> jobs;
+        std::size_t running = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+
+        // Statistics
+        std::size_t written = 0;
+        std::size_t failed = 0;
+        std::size_t max_depth = 0;
+        double total_latency = 0.0;         // ms
+        double max_latency = 0.0;           // ms
+
+        void run();
+
+    public:
+        explicit AsyncWriter(const std::size_t& threads = 2, const std::size_t& max_queue = 64, const bool& verbose = false);
+        ~AsyncWriter();
+
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+        void submit(const std::string& path, std::function<void()> write);
+
+        // JPEG (or any format cv::imwrite infers from the extension)
+        void write_jpeg(const cv::Mat& img, const std::string& path);
+
+        // NIfTI via panorama::write_image
+        template <typename PixelType, int DIM=3>
+        void write_image(const typename itk::Image<PixelType, DIM>::Pointer& img, const std::string& path) {
+            typename itk::Image<PixelType, DIM>::Pointer owned = img;
+            submit(path, [owned, path] {
+                if (!panorama::write_image<PixelType, DIM>(owned, path)) {
+                    throw std::runtime_error("itk::ImageFileWriter failed");
+                }
+            });
+        }
+
+        // Block until every submitted file is written
+        void wait();
+
+        std::size_t queue_depth();
+    };
+}
@@ -1,16 +1,28 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <boost/filesystem.hpp>
 
 namespace utils {
+    // Volume metadata read from the image header only
+    struct ImageInfo {
+        bool valid = false;                 // header could be read
+        std::array<std::size_t, 3> size = {0, 0, 0};
+        std::array<double, 3> spacing = {0, 0, 0};
+        short datatype = 0;                 // NIFTI_TYPE_* code
+
+        std::size_t voxels() const { return size[0] * size[1] * size[2]; }
+    };
+
     class Dataset {
     private:
         boost::filesystem::path path;
         boost::filesystem::path root;
         std::vector<boost::filesystem::path> paths;
+        std::vector<ImageInfo> infos;
 
     public:
         Dataset() = default;
@@ -21,5 +33,12 @@ namespace utils {
         std::vector<boost::filesystem::path> image_paths() const;
         std::size_t size() const;
         boost::filesystem::path image_path(std::size_t index) const;
+
+        // Read the header of every image (in parallel) and keep size, spacing and datatype
+        void probe();
+        // Probed metadata (invalid until probe() is called)
+        ImageInfo image_info(std::size_t index) const;
+        // Indices, largest volume first (LPT order); unreadable headers last, in dataset order
+        std::vector<std::size_t> schedule() const;
     };
 }
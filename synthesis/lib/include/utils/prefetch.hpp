@@ -0,0 +1,129 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace utils {
+    /*
+     * Bounded look-ahead loader.
+     * I/O threads call load(i) for i = 0 .. count-1 (in order of index) while consumers pop
+     * finished items. A new load only starts while fewer than `depth` items are waiting and
+     * their total size (bytes(item)) is below `memory_cap` (0 = no cap); the cap is soft,
+     * it can be exceeded by the items already being loaded.
+     * OpenMP regions inside load() run with `omp_threads` threads per I/O thread, so loading
+     * does not oversubscribe the cores the consumers' parallel regions are using.
+     */
+    template <typename T>
+    class Prefetcher {
+    private:
+        std::size_t count;
+        std::function<T(const std::size_t&)> load;
+        std::function<std::size_t(const T&)> bytes;
+        std::size_t depth;
+        std::size_t memory_cap;
+        std::size_t omp_threads;
+
+        std::mutex mutex;
+        std::condition_variable loaded;     // an item is ready (or loading finished)
+        std::condition_variable consumed;   // room for another load
+        std::map<std::size_t, T> ready;
+        std::size_t ready_bytes = 0;
+        std::size_t next_load = 0;
+        std::size_t finished = 0;
+        std::vector<std::thread> workers;
+
+        void run() {
+#ifdef _OPENMP
+            omp_set_num_threads(static_cast<int>(omp_threads));
+#endif
+
+            for (;;) {
+                std::size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    consumed.wait(lock, [this] {
+                        return next_load >= count ||
+                               (ready.size() < depth && (memory_cap == 0 || ready_bytes < memory_cap));
+                    });
+                    if (next_load >= count) {
+                        return;
+                    }
+                    index = next_load++;
+                }
+
+                T item = load(index);
+                const std::size_t item_bytes = bytes(item);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ready.emplace(index, std::move(item));
+                    ready_bytes += item_bytes;
+                }
+                loaded.notify_one();
+            }
+        }
+
+    public:
+        Prefetcher(
+            const std::size_t& count,
+            std::function<T(const std::size_t&)> load,
+            std::function<std::size_t(const T&)> bytes,
+            const std::size_t& io_threads = 2,
+            const std::size_t& depth = 4,
+            const std::size_t& memory_cap = 0,
+            const std::size_t& omp_threads = 1
+        ) : count(count), load(std::move(load)), bytes(std::move(bytes)),
+            depth(depth > 0 ? depth : 1), memory_cap(memory_cap), omp_threads(omp_threads > 0 ? omp_threads : 1) {
+            const std::size_t threads = io_threads > 0 ? io_threads : 1;
+            for (std::size_t t = 0; t < threads; ++t) {
+                workers.emplace_back(&Prefetcher::run, this);
+            }
+        }
+
+        ~Prefetcher() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                next_load = count;      // stop issuing new loads
+            }
+            consumed.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        Prefetcher(const Prefetcher&) = delete;
+        Prefetcher& operator=(const Prefetcher&) = delete;
+
+        // Next loaded item (lowest ready index first); false once every item has been handed out
+        bool pop(std::size_t& index, T& item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            loaded.wait(lock, [this] { return !ready.empty() || finished >= count; });
+            if (ready.empty()) {
+                return false;
+            }
+
+            auto it = ready.begin();
+            index = it->first;
+            item = std::move(it->second);
+            ready_bytes -= bytes(item);
+            ready.erase(it);
+
+            if (++finished >= count) {
+                loaded.notify_all();    // release the other consumers
+            }
+            lock.unlock();
+            consumed.notify_one();
+            return true;
+        }
+    };
+}
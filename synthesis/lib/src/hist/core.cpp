@@ -10,6 +10,23 @@
 #include <opencv2/opencv.hpp>
 
 
+namespace {
+    // Gaussian smoothing of a horizontal histogram
+    std::vector<short> smooth_horizontal_histogram(std::vector<short>& histogram) {
+        const int kernel_size = 5;
+        const double sigma = 1.0;
+
+        cv::Mat hist_mat = cv::Mat(histogram).reshape(1, 1);  // 1-row Mat
+        cv::Mat smoothed_hist;
+
+        cv::GaussianBlur(hist_mat, smoothed_hist, cv::Size(kernel_size, kernel_size), sigma);
+
+        // Convert back to std::vector<short>
+        return std::vector<short>(smoothed_hist.begin<short>(), smoothed_hist.end<short>());
+    }
+}
+
+
 // 2D Image -> Intensity Histogram (0 ~ 255)
 template <typename PixelType>
 std::vector<short> 
@@ -105,17 +122,19 @@ panorama::compute_horizontal_histogram(
         }
     }
 
-    // Apply Gaussian smoothing
-    const int kernel_size = 5;
-    const double sigma = 1.0;
+    return smooth_horizontal_histogram(histogram);
+}
 
-    cv::Mat hist_mat = cv::Mat(histogram).reshape(1, 1);  // 1-row Mat
-    cv::Mat smoothed_hist;
 
-    cv::GaussianBlur(hist_mat, smoothed_hist, cv::Size(kernel_size, kernel_size), sigma);
+// Coronal Bit Mask -> Horizontal Histogram
+std::vector<short>
+panorama::compute_horizontal_histogram(const BitMask& mask) {
+    std::vector<short> histogram(mask.height, 0);
+    for (std::size_t y = 0; y < mask.height; ++y) {
+        histogram[y] = static_cast<short>(mask.count_row(y));
+    }
 
-    // Convert back to std::vector<short>
-    return std::vector<short>(smoothed_hist.begin<short>(), smoothed_hist.end<short>());
+    return smooth_horizontal_histogram(histogram);
 }
 
 
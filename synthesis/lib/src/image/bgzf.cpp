@@ -0,0 +1,326 @@
+#include "../../include/image/bgzf.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+
+
+namespace {
+    // Member layout: 18-byte header (with the "BC" field), raw deflate data, CRC32, ISIZE
+    constexpr std::size_t HEADER_SIZE = 18;
+    constexpr std::size_t FOOTER_SIZE = 8;
+    constexpr std::size_t MAX_BLOCK_SIZE = 1 << 16;
+    // Uncompressed bytes per block; leaves room for stored (incompressible) deflate data
+    constexpr std::size_t BLOCK_DATA_SIZE = 0xff00;
+
+    // Empty member marking the end of a BGZF file
+    constexpr unsigned char EOF_BLOCK[28] = {
+        0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+        0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+
+    struct Block {
+        std::size_t offset;         // in the compressed file
+        std::size_t size;           // compressed member size
+        std::size_t data_offset;    // in the uncompressed stream
+        std::size_t data_size;
+    };
+
+    std::uint16_t load16(const unsigned char* p) {
+        return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    std::uint32_t load32(const unsigned char* p) {
+        return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+               (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+    }
+
+    void store16(unsigned char* p, const std::uint32_t& value) {
+        p[0] = static_cast<unsigned char>(value);
+        p[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    void store32(unsigned char* p, const std::uint32_t& value) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<unsigned char>(value >> (8 * i));
+        }
+    }
+
+    // Compressed member size, 0 if p is not a BGZF member header
+    std::size_t member_size(const unsigned char* p, const std::size_t& available) {
+        if (available < HEADER_SIZE || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4) ||
+            load16(p + 10) != 6 || p[12] != 'B' || p[13] != 'C' || load16(p + 14) != 2) {
+            return 0;
+        }
+        const std::size_t size = static_cast<std::size_t>(load16(p + 16)) + 1;
+        return size >= HEADER_SIZE + FOOTER_SIZE && size <= available ? size : 0;
+    }
+
+    // Read-only view of a whole file
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path) {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* address = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED) {
+                    data = static_cast<const unsigned char*>(address);
+                    size = static_cast<std::size_t>(st.st_size);
+                }
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (data) {
+                munmap(const_cast<unsigned char*>(data), size);
+            }
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const unsigned char* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    // Block table of a mapped BGZF file; false if any member is not BGZF
+    bool index_blocks(const MappedFile& file, std::vector<Block>& blocks) {
+        blocks.clear();
+        std::size_t offset = 0;
+        std::size_t data_offset = 0;
+        while (offset < file.size) {
+            const std::size_t size = member_size(file.data + offset, file.size - offset);
+            if (size == 0) {
+                return false;
+            }
+            const std::size_t data_size = load32(file.data + offset + size - 4);
+            if (data_size > MAX_BLOCK_SIZE) {
+                return false;
+            }
+            if (data_size > 0) {
+                blocks.push_back({offset, size, data_offset, data_size});
+            }
+            offset += size;
+            data_offset += data_size;
+        }
+        return true;
+    }
+
+    // One member -> out (block.data_size bytes)
+    bool inflate_block(z_stream& stream, const unsigned char* member, const Block& block, unsigned char* out) {
+        if (inflateReset(&stream) != Z_OK) {
+            return false;
+        }
+        stream.next_in = const_cast<unsigned char*>(member + HEADER_SIZE);
+        stream.avail_in = static_cast<uInt>(block.size - HEADER_SIZE - FOOTER_SIZE);
+        stream.next_out = out;
+        stream.avail_out = static_cast<uInt>(block.data_size);
+        if (inflate(&stream, Z_FINISH) != Z_STREAM_END || stream.avail_out != 0) {
+            return false;
+        }
+        const std::uint32_t crc = load32(member + block.size - FOOTER_SIZE);
+        return crc32(0L, out, static_cast<uInt>(block.data_size)) == crc;
+    }
+}
+
+
+bool panorama::is_bgzf(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[HEADER_SIZE];
+    if (!file || !file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    // The size field is checked against the largest possible member only
+    return member_size(header, MAX_BLOCK_SIZE) != 0;
+}
+
+
+std::size_t panorama::bgzf_size(const std::string& path) {
+    const MappedFile file(path);
+    std::vector<Block> blocks;
+    if (!file.data || !index_blocks(file, blocks) || blocks.empty()) {
+        return 0;
+    }
+    return blocks.back().data_offset + blocks.back().data_size;
+}
+
+
+// BGZF bytes [begin, begin + length) -> out
+bool panorama::inflate_bgzf(const std::string& path, const std::size_t& begin, const std::size_t& length, char* out) {
+    const MappedFile file(path);
+    std::vector<Block> blocks;
+    if (!file.data || !index_blocks(file, blocks)) {
+        return false;
+    }
+
+    const std::size_t end = begin + length;
+    if (length == 0) {
+        return true;
+    }
+    if (blocks.empty() || blocks.back().data_offset + blocks.back().data_size < end) {
+        return false;
+    }
+
+    // Blocks overlapping the requested range
+    auto first = std::upper_bound(blocks.begin(), blocks.end(), begin,
+                                  [](const std::size_t& pos, const Block& b) { return pos < b.data_offset + b.data_size; });
+    auto last = std::lower_bound(first, blocks.end(), end,
+                                 [](const Block& b, const std::size_t& pos) { return b.data_offset < pos; });
+    const long first_block = static_cast<long>(first - blocks.begin());
+    const long last_block = static_cast<long>(last - blocks.begin());
+
+    bool ok = true;
+    #pragma omp parallel reduction(&&:ok)
+    {
+        z_stream stream{};
+        const bool initialized = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        ok = initialized;
+        std::vector<unsigned char> scratch(MAX_BLOCK_SIZE);
+
+        #pragma omp for schedule(dynamic, 16)
+        for (long i = first_block; i < last_block; ++i) {
+            if (!ok) {
+                continue;
+            }
+            const Block& block = blocks[i];
+            const unsigned char* member = file.data + block.offset;
+            const std::size_t from = std::max(begin, block.data_offset);
+            const std::size_t to = std::min(end, block.data_offset + block.data_size);
+
+            // Whole blocks are inflated in place, partial ones (range ends) through the scratch buffer
+            if (from == block.data_offset && to == block.data_offset + block.data_size) {
+                ok = inflate_block(stream, member, block, reinterpret_cast<unsigned char*>(out + (from - begin)));
+            } else {
+                ok = inflate_block(stream, member, block, scratch.data());
+                if (ok) {
+                    std::memcpy(out + (from - begin), scratch.data() + (from - block.data_offset), to - from);
+                }
+            }
+        }
+
+        if (initialized) {
+            inflateEnd(&stream);
+        }
+    }
+
+    return ok;
+}
+
+
+// gzip -> BGZF
+bool panorama::convert_to_bgzf(const std::string& src, const std::string& dst, const int& level) {
+    namespace fs = boost::filesystem;
+
+    gzFile in = gzopen(src.c_str(), "rb");
+    if (in == nullptr) {
+        std::cerr << "[WARNING] cannot open " << src << std::endl;
+        return false;
+    }
+    gzbuffer(in, 1 << 20);
+
+    const fs::path temporary = dst + "." + fs::unique_path().string() + ".tmp";
+    std::ofstream out(temporary.string(), std::ios::binary);
+
+    // Blocks compressed together, then written in order
+    const std::size_t batch = 256;
+    std::vector<unsigned char> input(batch * BLOCK_DATA_SIZE);
+    std::vector<std::vector<unsigned char>> members(batch);
+
+    bool ok = static_cast<bool>(out);
+    while (ok) {
+        // Fill the batch (gzread returns short counts at member boundaries)
+        std::size_t filled = 0;
+        int n = 0;
+        while (filled < input.size() &&
+               (n = gzread(in, input.data() + filled, static_cast<unsigned>(input.size() - filled))) > 0) {
+            filled += static_cast<std::size_t>(n);
+        }
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        if (filled == 0) {
+            break;
+        }
+
+        const long block_num = static_cast<long>((filled + BLOCK_DATA_SIZE - 1) / BLOCK_DATA_SIZE);
+        #pragma omp parallel for schedule(dynamic, 1) reduction(&&:ok)
+        for (long i = 0; i < block_num; ++i) {
+            const unsigned char* data = input.data() + i * BLOCK_DATA_SIZE;
+            const std::size_t data_size = std::min(BLOCK_DATA_SIZE, filled - i * BLOCK_DATA_SIZE);
+
+            std::vector<unsigned char>& member = members[i];
+            member.resize(MAX_BLOCK_SIZE);
+
+            z_stream stream{};
+            // Incompressible data is stored (level 0) so the member always fits in 64 KiB
+            for (const int block_level : {level, 0}) {
+                if (deflateInit2(&stream, block_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                    ok = false;
+                    break;
+                }
+                stream.next_in = const_cast<unsigned char*>(data);
+                stream.avail_in = static_cast<uInt>(data_size);
+                stream.next_out = member.data() + HEADER_SIZE;
+                stream.avail_out = static_cast<uInt>(MAX_BLOCK_SIZE - HEADER_SIZE - FOOTER_SIZE);
+                const int status = deflate(&stream, Z_FINISH);
+                const std::size_t compressed = stream.total_out;
+                deflateEnd(&stream);
+
+                if (status == Z_STREAM_END) {
+                    const std::size_t size = HEADER_SIZE + compressed + FOOTER_SIZE;
+                    std::memcpy(member.data(), EOF_BLOCK, HEADER_SIZE);
+                    store16(member.data() + 16, static_cast<std::uint32_t>(size - 1));
+                    store32(member.data() + size - 8, crc32(0L, data, static_cast<uInt>(data_size)));
+                    store32(member.data() + size - 4, static_cast<std::uint32_t>(data_size));
+                    member.resize(size);
+                    break;
+                }
+                if (block_level == 0) {
+                    ok = false;
+                }
+            }
+        }
+
+        for (long i = 0; ok && i < block_num; ++i) {
+            out.write(reinterpret_cast<const char*>(members[i].data()), static_cast<std::streamsize>(members[i].size()));
+        }
+        ok = ok && static_cast<bool>(out);
+    }
+    gzclose(in);
+
+    out.write(reinterpret_cast<const char*>(EOF_BLOCK), sizeof(EOF_BLOCK));
+    out.close();
+
+    boost::system::error_code ec;
+    if (!ok || !out) {
+        std::cerr << "[WARNING] failed to convert " << src << std::endl;
+        fs::remove(temporary, ec);
+        return false;
+    }
+
+    fs::rename(temporary, dst, ec);
+    if (ec) {
+        std::cerr << "[WARNING] failed to write " << dst << ": " << ec.message() << std::endl;
+        fs::remove(temporary, ec);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,279 @@
+#include "../../include/image/cache.hpp"
+#include "../../include/image/pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+#include <sys/stat.h>
+
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+
+#include <itkImage.h>
+
+
+namespace {
+    constexpr char MAGIC[8] = {'P', 'C', 'T', 'V', 'O', 'L', '1', '\0'};
+    constexpr std::size_t SAMPLE_SIZE = 1 << 16;
+    constexpr std::size_t SAMPLE_NUM = 16;
+
+    // FNV-1a (64 bit)
+    std::uint64_t hash_bytes(const void* data, const std::size_t& size, std::uint64_t hash = 0xcbf29ce484222325ULL) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    std::string to_hex(const std::uint64_t& value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    // NIfTI datatype codes, so entries name their pixel type the same way as the inputs
+    template <typename PixelType>
+    constexpr std::uint32_t pixel_code() {
+        return std::is_same<PixelType, short>::value ? 4 : std::is_same<PixelType, double>::value ? 64 : 0;
+    }
+
+    // Fixed part of an entry header
+    struct Header {
+        char magic[8];
+        std::uint32_t pixel_type;
+        std::uint32_t chunk_slices;
+        std::uint64_t size[3];
+        double spacing[3];
+        double origin[3];
+        double direction[9];
+        std::uint32_t value_num;
+        std::uint32_t reserved;
+    };
+}
+
+
+// file -> fingerprint
+std::string panorama::fingerprint_file(const std::string& path) {
+    struct stat st;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file || stat(path.c_str(), &st) != 0) {
+        return std::string();
+    }
+    const std::uint64_t size = static_cast<std::uint64_t>(file.tellg());
+
+    // Modification time catches rewrites the samples below would miss. Device and inode are left
+    // out: they change when an NFS export is remounted although the file does not.
+    const std::uint64_t identity[3] = {
+        static_cast<std::uint64_t>(st.st_mtim.tv_sec), static_cast<std::uint64_t>(st.st_mtim.tv_nsec), size
+    };
+    std::uint64_t hash = hash_bytes(identity, sizeof(identity));
+    std::vector<char> sample(SAMPLE_SIZE);
+    const std::uint64_t last = size > SAMPLE_SIZE ? size - SAMPLE_SIZE : 0;
+    for (std::size_t i = 0; i < SAMPLE_NUM; ++i) {
+        const std::uint64_t offset = last * i / (SAMPLE_NUM - 1);
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(sample.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(SAMPLE_SIZE, size - offset)));
+        hash = hash_bytes(sample.data(), static_cast<std::size_t>(file.gcount()), hash);
+        file.clear();
+    }
+    return to_hex(hash);
+}
+
+
+panorama::VolumeCache::VolumeCache(const std::string& dir, const int& chunk_slices, const int& level)
+    : dir(dir), chunk_slices(std::max(chunk_slices, 1)), level(level) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir, ec);
+}
+
+
+std::string panorama::VolumeCache::key(
+    const std::string& fingerprint,
+    const std::string& stage,
+    const std::string& params
+) const {
+    std::uint64_t hash = hash_bytes(fingerprint.data(), fingerprint.size());
+    hash = hash_bytes("", 1, hash);
+    hash = hash_bytes(stage.data(), stage.size(), hash);
+    hash = hash_bytes("", 1, hash);
+    hash = hash_bytes(params.data(), params.size(), hash);
+    return (boost::filesystem::path(dir) / (stage + "-" + to_hex(hash) + ".pcv")).string();
+}
+
+
+// cache entry -> itkImage
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::VolumeCache::load(const std::string& key, std::vector<double>& values) const {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    std::ifstream file(key, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.pixel_type != pixel_code<PixelType>() || header.chunk_slices == 0 || header.value_num > 1024) {
+        std::cerr << "[WARNING] ignoring cache entry " << key << std::endl;
+        return nullptr;
+    }
+
+    const std::size_t plane = header.size[0] * header.size[1];
+    const std::size_t chunk_num = (header.size[2] + header.chunk_slices - 1) / header.chunk_slices;
+    std::vector<double> stored(header.value_num);
+    std::vector<std::uint64_t> chunk_bytes(chunk_num);
+    file.read(reinterpret_cast<char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(double)));
+    file.read(reinterpret_cast<char*>(chunk_bytes.data()), static_cast<std::streamsize>(chunk_num * sizeof(std::uint64_t)));
+
+    std::vector<std::size_t> chunk_begin(chunk_num + 1, 0);
+    for (std::size_t c = 0; c < chunk_num; ++c) {
+        chunk_begin[c + 1] = chunk_begin[c] + chunk_bytes[c];
+    }
+    const std::streamoff data_begin = file.tellg();
+    file.seekg(0, std::ios::end);
+    if (!file || data_begin < 0 || static_cast<std::uint64_t>(file.tellg() - data_begin) != chunk_begin[chunk_num]) {
+        std::cerr << "[WARNING] truncated cache entry " << key << std::endl;
+        return nullptr;
+    }
+    file.seekg(data_begin);
+
+    std::vector<unsigned char> compressed(chunk_begin[chunk_num]);
+    if (!file.read(reinterpret_cast<char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()))) {
+        std::cerr << "[WARNING] truncated cache entry " << key << std::endl;
+        return nullptr;
+    }
+
+    typename ImageType::SizeType size;
+    typename ImageType::SpacingType spacing;
+    typename ImageType::PointType origin;
+    typename ImageType::DirectionType direction;
+    for (unsigned int i = 0; i < 3; ++i) {
+        size[i] = header.size[i];
+        spacing[i] = header.spacing[i];
+        origin[i] = header.origin[i];
+        for (unsigned int j = 0; j < 3; ++j) {
+            direction[i][j] = header.direction[3 * i + j];
+        }
+    }
+
+    typename ImageType::RegionType region;
+    region.SetSize(size);
+
+    auto img = ImageType::New();
+    img->SetRegions(region);
+    img->SetSpacing(spacing);
+    img->SetOrigin(origin);
+    img->SetDirection(direction);
+    allocate_image<PixelType, 3>(img);
+
+    PixelType* buffer = img->GetBufferPointer();
+    const long chunks = static_cast<long>(chunk_num);
+    bool ok = true;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(&&:ok)
+    for (long c = 0; c < chunks; ++c) {
+        const std::size_t z0 = static_cast<std::size_t>(c) * header.chunk_slices;
+        const std::size_t z1 = std::min<std::size_t>(z0 + header.chunk_slices, header.size[2]);
+        uLongf length = static_cast<uLongf>((z1 - z0) * plane * sizeof(PixelType));
+        const uLongf expected = length;
+        ok = uncompress(reinterpret_cast<Bytef*>(buffer + z0 * plane), &length,
+                        compressed.data() + chunk_begin[c], static_cast<uLong>(chunk_bytes[c])) == Z_OK &&
+             length == expected;
+    }
+    if (!ok) {
+        std::cerr << "[WARNING] corrupt cache entry " << key << std::endl;
+        return nullptr;
+    }
+
+    values = std::move(stored);
+    return img;
+}
+
+
+// itkImage -> cache entry
+template <typename PixelType>
+bool panorama::VolumeCache::store(
+    const std::string& key,
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const std::vector<double>& values
+) const {
+    namespace fs = boost::filesystem;
+
+    const typename itk::Image<PixelType, 3>::RegionType region = img->GetLargestPossibleRegion();
+    typename itk::Image<PixelType, 3>::PointType origin;
+    img->TransformIndexToPhysicalPoint(region.GetIndex(), origin);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.pixel_type = pixel_code<PixelType>();
+    header.chunk_slices = static_cast<std::uint32_t>(chunk_slices);
+    for (unsigned int i = 0; i < 3; ++i) {
+        header.size[i] = region.GetSize(i);
+        header.spacing[i] = img->GetSpacing()[i];
+        header.origin[i] = origin[i];
+        for (unsigned int j = 0; j < 3; ++j) {
+            header.direction[3 * i + j] = img->GetDirection()[i][j];
+        }
+    }
+    header.value_num = static_cast<std::uint32_t>(values.size());
+
+    const std::size_t plane = header.size[0] * header.size[1];
+    const std::size_t chunk_num = (header.size[2] + chunk_slices - 1) / chunk_slices;
+    const PixelType* buffer = img->GetBufferPointer();
+
+    std::vector<std::vector<unsigned char>> chunks(chunk_num);
+    std::vector<std::uint64_t> chunk_bytes(chunk_num);
+    const long chunk_count = static_cast<long>(chunk_num);
+    bool ok = true;
+    #pragma omp parallel for schedule(dynamic, 1) reduction(&&:ok)
+    for (long c = 0; c < chunk_count; ++c) {
+        const std::size_t z0 = static_cast<std::size_t>(c) * chunk_slices;
+        const std::size_t z1 = std::min<std::size_t>(z0 + chunk_slices, header.size[2]);
+        const uLong raw = static_cast<uLong>((z1 - z0) * plane * sizeof(PixelType));
+        uLongf length = compressBound(raw);
+        chunks[c].resize(length);
+        ok = compress2(chunks[c].data(), &length, reinterpret_cast<const Bytef*>(buffer + z0 * plane), raw, level) == Z_OK;
+        chunks[c].resize(length);
+        chunk_bytes[c] = length;
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Written under a unique name and renamed, so concurrent jobs never read a partial entry
+    const fs::path temporary = key + "." + fs::unique_path().string() + ".tmp";
+    std::ofstream file(temporary.string(), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+    file.write(reinterpret_cast<const char*>(chunk_bytes.data()), static_cast<std::streamsize>(chunk_num * sizeof(std::uint64_t)));
+    for (const auto& chunk : chunks) {
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+    file.close();
+
+    boost::system::error_code ec;
+    if (!file) {
+        std::cerr << "[WARNING] failed to write cache entry " << key << std::endl;
+        fs::remove(temporary, ec);
+        return false;
+    }
+    fs::rename(temporary, key, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+#define PIXEL_TYPE_CACHE(T) \
+    template itk::Image<T, 3>::Pointer panorama::VolumeCache::load<T>(const std::string& key, std::vector<double>& values) const; \
+    template bool panorama::VolumeCache::store<T>(const std::string& key, const typename itk::Image<T, 3>::Pointer& img, const std::vector<double>& values) const;
+PIXEL_TYPE_CACHE(double)
+PIXEL_TYPE_CACHE(short)
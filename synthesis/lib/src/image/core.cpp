@@ -1,6 +1,10 @@
 #include "../../include/image/core.hpp"
+#include "../../include/image/pool.hpp"
+#include "../../include/image/shear.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
@@ -15,16 +19,14 @@
 template <typename PixelType>
 typename itk::Image<PixelType, 3>::Pointer
 panorama::resampling_ct_image(
-    const typename itk::Image<PixelType, 3>::Pointer& img
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const ResampleKernel& kernel
 ) {
     // 型定義（明示）
     typedef itk::Image<PixelType, 3> ImageType;
-    typedef itk::ResampleImageFilter<ImageType, ImageType> ResampleFilterType;
-    typedef itk::LinearInterpolateImageFunction<ImageType, double> InterpolatorType;
 
-    // 入力画像の spacing / size を取得
+    // 入力画像の spacing を取得
     typename ImageType::SpacingType input_spacing = img->GetSpacing();
-    typename ImageType::SizeType input_size = img->GetLargestPossibleRegion().GetSize();
 
     // X, Y spacing が一致している前提で、Zをそれに合わせる
     double target_spacing_value = input_spacing[0];
@@ -41,25 +43,13 @@ panorama::resampling_ct_image(
     spacing[1] = target_spacing_value;
     spacing[2] = target_spacing_value;
 
-    // spacing に合わせて新しいサイズを計算
-    typename ImageType::SizeType new_size;
-    for (unsigned int i = 0; i < 3; ++i) {
-        new_size[i] = static_cast<unsigned int>(
-            input_size[i] * (input_spacing[i] / spacing[i])
-        );
-    }
-
-    // Resample フィルタの設定
-    typename ResampleFilterType::Pointer resampler = ResampleFilterType::New();
-    resampler->SetInput(img);
-    resampler->SetOutputSpacing(spacing);
-    resampler->SetSize(new_size);
-    resampler->SetOutputOrigin(img->GetOrigin());
-    resampler->SetOutputDirection(img->GetDirection());
-    resampler->SetInterpolator(InterpolatorType::New());
-    resampler->Update();
-
-    return resampler->GetOutput();
+    // 既に等方であればそのまま返す（コピーしない）
+    if (spacing == input_spacing) {
+        return img;
+    }
+
+    // 分離可能な 1 次元リサンプリング（サイズは spacing に合わせて resample_image が計算）
+    return resample_image<PixelType>(img, spacing, kernel);
 }
 
 
@@ -80,62 +70,76 @@ panorama::window_ct_image(const typename itk::Image<PixelType, 3>::Pointer& img)
     auto img3d = itk::Image<PixelType, 3>::New();
     img3d->SetRegions(region);
     img3d->SetSpacing(img->GetSpacing());
-    img3d->Allocate();
+    allocate_image<PixelType, 3>(img3d);
 
     // Apply windowing to each voxel
-    for (std::size_t z = 0; z < size[2]; ++z) {
-        for (std::size_t y = 0; y < size[1]; ++y) {
-            for (std::size_t x = 0; x < size[0]; ++x) {
-                typename itk::Image<PixelType, 3>::IndexType idx;
-                idx[0] = x;
-                idx[1] = y;
-                idx[2] = z;
-
-                auto value = img->GetPixel(idx);
-
-                // Clamp to HU window range
-                if (value > HU_MAX) {
-                    value = HU_MAX;
-                } else if (value < HU_MIN) {
-                    value = HU_MIN;
-                }
+    const std::size_t voxels = region.GetNumberOfPixels();
+    const PixelType* src = img->GetBufferPointer();
+    PixelType* dst = img3d->GetBufferPointer();
 
-                img3d->SetPixel(idx, value);
-            }
-        }
+    #pragma omp parallel for simd schedule(static)
+    for (std::size_t i = 0; i < voxels; ++i) {
+        dst[i] = clamp_hu(src[i]);
     }
 
     return img3d;
 }
 
 
-// Extract CT Slices
+// Windowing in place (no second volume is allocated)
+template <typename PixelType>
+void panorama::window_ct_image_inplace(const typename itk::Image<PixelType, 3>::Pointer& img) {
+    const std::size_t voxels = img->GetLargestPossibleRegion().GetNumberOfPixels();
+    PixelType* buffer = img->GetBufferPointer();
+
+    // Only out-of-range voxels are stored: pages of a mapped (copy-on-write) volume that are
+    // already in range are never written, so they stay shared with the page cache
+    #pragma omp parallel for schedule(static)
+    for (std::size_t i = 0; i < voxels; ++i) {
+        const PixelType value = clamp_hu(buffer[i]);
+        if (value != buffer[i]) {
+            buffer[i] = value;
+        }
+    }
+
+    // Same geometry as the volume window_ct_image returns: only the spacing is kept
+    typename itk::Image<PixelType, 3>::PointType origin;
+    origin.Fill(0.0);
+    typename itk::Image<PixelType, 3>::DirectionType direction;
+    direction.SetIdentity();
+    img->SetOrigin(origin);
+    img->SetDirection(direction);
+}
+
+
+// Extract CT Slices (a view into the parent buffer unless a copy is requested)
 template <typename PixelType>
 typename itk::Image<PixelType, 3>::Pointer 
 panorama::extract_slices(
     const typename itk::Image<PixelType, 3>::Pointer& img, 
-    const std::pair<short, short>& range
+    const std::pair<short, short>& range,
+    const bool& copy
 ) {
     short As = range.first;
     short Ae = range.second;
     short slice_num = static_cast<short>(img->GetLargestPossibleRegion().GetSize(2));
 
-    if (As <= 0 && Ae >= slice_num) {
+    if (As <= 0 && Ae >= slice_num && !copy) {
         return img;
     }
 
     if (As <= 0) As = 0;
     if (Ae >= slice_num) Ae = slice_num;
+    if (Ae < As) Ae = As;
 
     typename itk::Image<PixelType, 3>::IndexType start;
     start[0] = 0;
     start[1] = 0;
-    start[2] = 0;
+    start[2] = As;
 
-    typename itk::Image<PixelType, 3>::SpacingType spacing;
-    spacing[0] = img->GetSpacing()[0];
-    spacing[1] = img->GetSpacing()[1];
-    spacing[2] = img->GetSpacing()[2];
+    // Origin on the first extracted slice
+    typename itk::Image<PixelType, 3>::PointType origin;
+    img->TransformIndexToPhysicalPoint(start, origin);
 
     typename itk::Image<PixelType, 3>::SizeType size;
     size[0] = img->GetLargestPossibleRegion().GetSize(0);
@@ -144,47 +148,159 @@ panorama::extract_slices(
 
     typename itk::Image<PixelType, 3>::RegionType region;
     region.SetSize(size);
-    region.SetIndex(start);
 
     auto img3d = itk::Image<PixelType, 3>::New();
     img3d->SetRegions(region);
-    img3d->SetSpacing(spacing);
-    img3d->Allocate();
+    img3d->SetSpacing(img->GetSpacing());
+    img3d->SetOrigin(origin);
+    img3d->SetDirection(img->GetDirection());
+
+    // A z-slab of the x-fastest buffer is one contiguous range
+    const std::size_t plane = size[0] * size[1];
+    PixelType* slab = img->GetBufferPointer() + As * plane;
+    const std::size_t pixels = plane * size[2];
+
+    if (copy) {
+        allocate_image<PixelType, 3>(img3d);
+        std::copy(slab, slab + pixels, img3d->GetBufferPointer());
+        return img3d;
+    }
 
-    for (std::size_t z = As; z < Ae; ++z) {
-        for (std::size_t y = 0; y < img->GetLargestPossibleRegion().GetSize(1); ++y) {
-            for (std::size_t x = 0; x < img->GetLargestPossibleRegion().GetSize(0); ++x) {
-                typename itk::Image<PixelType, 3>::IndexType idx3;
-                idx3[0] = static_cast<long>(x);
-                idx3[1] = static_cast<long>(y);
-                idx3[2] = static_cast<long>(z);
+    auto container = SharedImageContainer<itk::SizeValueType, PixelType>::New();
+    container->SetImportPointer(slab, pixels, false);
+    container->SetParent(img->GetPixelContainer());
+    img3d->SetPixelContainer(container);
+
+    return img3d;
+}
 
-                const auto pixel_value = img->GetPixel(idx3);
-                idx3[2] -= As;
 
-                img3d->SetPixel(idx3, pixel_value);
+// Head bounding box from a subsampled pass
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::RegionType
+panorama::calc_head_region(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const PixelType& threshold,
+    const std::size_t& step,
+    const std::size_t& margin
+) {
+    const typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
+    const long nx = static_cast<long>(size[0]);
+    const long ny = static_cast<long>(size[1]);
+    const long nz = static_cast<long>(size[2]);
+    const long stride = static_cast<long>(std::max<std::size_t>(step, 1));
+    const PixelType* buffer = img->GetBufferPointer();
+
+    long x0 = nx, y0 = ny, z0 = nz, x1 = -1, y1 = -1, z1 = -1;
+    #pragma omp parallel for schedule(dynamic) reduction(min:x0, y0, z0) reduction(max:x1, y1, z1)
+    for (long z = 0; z < nz; z += stride) {
+        for (long y = 0; y < ny; y += stride) {
+            const PixelType* row = buffer + (z * ny + y) * nx;
+            for (long x = 0; x < nx; x += stride) {
+                if (row[x] > threshold) {
+                    x0 = std::min(x0, x);
+                    x1 = std::max(x1, x);
+                    y0 = std::min(y0, y);
+                    y1 = std::max(y1, y);
+                    z0 = std::min(z0, z);
+                    z1 = std::max(z1, z);
+                }
             }
         }
     }
 
-    return img3d;
+    typename itk::Image<PixelType, 3>::RegionType region;
+    region.SetSize(size);
+    if (x1 < 0) {
+        return region;
+    }
+
+    // Unsampled voxels up to stride - 1 beyond the extremes may pass too
+    const long grow = static_cast<long>(margin) + stride - 1;
+    const long low[3] = {x0, y0, z0};
+    const long high[3] = {x1, y1, z1};
+    const long n[3] = {nx, ny, nz};
+    for (unsigned int i = 0; i < 3; ++i) {
+        const long begin = std::max(low[i] - grow, 0L);
+        const long end = std::min(high[i] + grow + 1, n[i]);
+        region.SetIndex(i, begin);
+        region.SetSize(i, static_cast<std::size_t>(end - begin));
+    }
+    return region;
 }
 
 
-// Rotate CT Image Around Reference Planes
+// Centered hull of a region: the margin on each axis is the smaller of its two sides
+itk::ImageRegion<3>
+panorama::calc_centered_region(const itk::ImageRegion<3>& region, const itk::Size<3>& size) {
+    itk::ImageRegion<3> centered;
+    for (unsigned int i = 0; i < 3; ++i) {
+        const long n = static_cast<long>(size[i]);
+        const long begin = std::min(std::max<long>(region.GetIndex(i), 0), n);
+        const long end = std::max(std::min(region.GetIndex(i) + static_cast<long>(region.GetSize(i)), n), begin);
+        const long margin = std::min(begin, n - end);
+        centered.SetIndex(i, margin);
+        centered.SetSize(i, static_cast<std::size_t>(n - 2 * margin));
+    }
+    return centered;
+}
+
+
+// Crop to an index region (clipped to the image)
 template <typename PixelType>
 typename itk::Image<PixelType, 3>::Pointer
-panorama::rotate_ct_image(
-    const typename itk::Image<PixelType, 3>::Pointer& img, 
-    const char& axis,
-    const double& angle
+panorama::crop_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const typename itk::Image<PixelType, 3>::RegionType& region
 ) {
-    // 1. Define the rotation transform
-    typename itk::AffineTransform<double, 3>::Pointer transform = itk::AffineTransform<double, 3>::New();
+    const typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
 
+    typename itk::Image<PixelType, 3>::IndexType first;
+    typename itk::Image<PixelType, 3>::SizeType crop_size;
+    for (unsigned int i = 0; i < 3; ++i) {
+        const long begin = std::min<long>(std::max<long>(region.GetIndex(i), 0), static_cast<long>(size[i]));
+        const long end = std::min<long>(region.GetIndex(i) + static_cast<long>(region.GetSize(i)), static_cast<long>(size[i]));
+        first[i] = begin;
+        crop_size[i] = static_cast<std::size_t>(std::max(end - begin, 0L));
+    }
+    if (crop_size == size) {
+        return img;
+    }
+
+    typename itk::Image<PixelType, 3>::PointType origin;
+    img->TransformIndexToPhysicalPoint(first, origin);
+
+    typename itk::Image<PixelType, 3>::RegionType crop_region;
+    crop_region.SetSize(crop_size);
+
+    auto img3d = itk::Image<PixelType, 3>::New();
+    img3d->SetRegions(crop_region);
+    img3d->SetSpacing(img->GetSpacing());
+    img3d->SetOrigin(origin);
+    img3d->SetDirection(img->GetDirection());
+    allocate_image<PixelType, 3>(img3d);
+
+    const PixelType* src = img->GetBufferPointer();
+    PixelType* dst = img3d->GetBufferPointer();
+    const long rows = static_cast<long>(crop_size[1] * crop_size[2]);
+    #pragma omp parallel for schedule(static)
+    for (long r = 0; r < rows; ++r) {
+        const long y = r % static_cast<long>(crop_size[1]);
+        const long z = r / static_cast<long>(crop_size[1]);
+        const PixelType* row = src + ((first[2] + z) * static_cast<long>(size[1]) + first[1] + y) * static_cast<long>(size[0]) + first[0];
+        std::copy(row, row + crop_size[0], dst + r * static_cast<long>(crop_size[0]));
+    }
+
+    return img3d;
+}
+
+
+// Rotation matrix around one axis ('x', 'y' or 'z'), angle in degrees
+itk::Matrix<double, 3, 3>
+panorama::calc_rotation_matrix(const char& axis, const double& angle) {
     double radians = angle * itk::Math::pi / 180.0;
 
-    itk::AffineTransform<double, 3>::MatrixType rotationMatrix;
+    itk::Matrix<double, 3, 3> rotationMatrix;
     rotationMatrix.SetIdentity();
 
     if (axis == 'x') {
@@ -206,29 +322,109 @@ panorama::rotate_ct_image(
         throw std::invalid_argument("Invalid axis. Use 'x', 'y', or 'z'.");
     }
 
-    transform->SetMatrix(rotationMatrix);
+    return rotationMatrix;
+}
+
+
+// Rotate CT Image Around Reference Planes
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::rotate_ct_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img, 
+    const char& axis,
+    const double& angle
+) {
+    return transform_ct_image<PixelType>(img, calc_rotation_matrix(axis, angle));
+}
+
+
+// Apply an accumulated pose (rotation about the volume center) with one resampling,
+// keeping only output slices [range.first, range.second)
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::transform_ct_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const itk::Matrix<double, 3, 3>& pose,
+    const std::pair<short, short>& range,
+    const RotationEngine& engine
+) {
+    typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
+
+    short slice_num = static_cast<short>(size[2]);
+    short As = std::max<short>(range.first, 0);
+    short Ae = std::min<short>(range.second, slice_num);
+    if (Ae < As) Ae = As;
+
+    typename itk::Image<PixelType, 3>::IndexType first_slice;
+    first_slice[0] = 0;
+    first_slice[1] = 0;
+    first_slice[2] = As;
+
+    size[2] = Ae - As;
+
+    return transform_ct_image<PixelType>(img, pose, typename itk::Image<PixelType, 3>::RegionType(first_slice, size), engine);
+}
+
+
+// Apply an accumulated pose with one resampling (or three shears), producing only the voxels of region
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::transform_ct_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const itk::Matrix<double, 3, 3>& pose,
+    const typename itk::Image<PixelType, 3>::RegionType& region,
+    const RotationEngine& engine
+) {
+    if (engine == RotationEngine::Shear) {
+        if (auto img_shear = shear_transform_ct_image<PixelType>(img, pose, region)) {
+            return img_shear;
+        }
+    }
 
-    // Center of rotation = image center
-    typename itk::Image<PixelType, 3>::PointType origin = img->GetOrigin();
     typename itk::Image<PixelType, 3>::SpacingType spacing = img->GetSpacing();
     typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
 
+    // 1. Define the transform
+    // The pose is measured on the index axes (MIPs of the buffer), so it is carried into
+    // physical space through the direction: D * pose * D^T
+    const typename itk::Image<PixelType, 3>::DirectionType& direction = img->GetDirection();
+    const itk::Matrix<double, 3, 3> direction_t(direction.GetTranspose());
+
+    typename itk::AffineTransform<double, 3>::Pointer transform = itk::AffineTransform<double, 3>::New();
+    transform->SetMatrix(direction * pose * direction_t);
+
+    // Center of rotation = center of the full volume (continuous index size / 2), whatever region is kept
+    itk::ContinuousIndex<double, 3> center_index;
+    for (unsigned int i = 0; i < 3; ++i) {
+        center_index[i] = size[i] / 2.0;
+    }
     itk::Point<double, 3> center;
-    center[0] = origin[0] + spacing[0] * size[0] / 2.0;
-    center[1] = origin[1] + spacing[1] * size[1] / 2.0;
-    center[2] = origin[2] + spacing[2] * size[2] / 2.0;
+    img->TransformContinuousIndexToPhysicalPoint(center_index, center);
 
     transform->SetCenter(center);
 
-    // 2. Setup resample filter
+    // 2. Output grid = input grid restricted to the region
+    typename itk::Image<PixelType, 3>::IndexType first;
+    typename itk::Image<PixelType, 3>::SizeType output_size;
+    for (unsigned int i = 0; i < 3; ++i) {
+        const long begin = std::min<long>(std::max<long>(region.GetIndex(i), 0), static_cast<long>(size[i]));
+        const long end = std::min<long>(region.GetIndex(i) + static_cast<long>(region.GetSize(i)), static_cast<long>(size[i]));
+        first[i] = begin;
+        output_size[i] = static_cast<std::size_t>(std::max(end - begin, 0L));
+    }
+
+    typename itk::Image<PixelType, 3>::PointType output_origin;
+    img->TransformIndexToPhysicalPoint(first, output_origin);
+
+    // 3. Setup resample filter
     typename itk::ResampleImageFilter<itk::Image<PixelType, 3>, itk::Image<PixelType, 3>>::Pointer resample =
         itk::ResampleImageFilter<itk::Image<PixelType, 3>, itk::Image<PixelType, 3>>::New();
 
     resample->SetInput(img);
     resample->SetTransform(transform);
-    resample->SetSize(size);
+    resample->SetSize(output_size);
     resample->SetOutputSpacing(spacing);
-    resample->SetOutputOrigin(origin);
+    resample->SetOutputOrigin(output_origin);
     resample->SetOutputDirection(img->GetDirection());
 
     typename itk::LinearInterpolateImageFunction<itk::Image<PixelType, 3>, double>::Pointer interpolator =
@@ -237,17 +433,63 @@ panorama::rotate_ct_image(
     resample->SetInterpolator(interpolator);
     resample->SetDefaultPixelValue(0);
 
-    // 3. Execute
+    // 4. Execute
     resample->Update();
     return resample->GetOutput();
 }
 
 
+// Physical box -> index region of the image grid
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::RegionType
+panorama::calc_output_region(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const itk::Point<double, 3>& lower,
+    const itk::Point<double, 3>& upper
+) {
+    // Continuous-index bounds of the box corners (the grid may be oblique to the physical axes)
+    double low[3], high[3];
+    std::fill(low, low + 3, std::numeric_limits<double>::max());
+    std::fill(high, high + 3, std::numeric_limits<double>::lowest());
+    for (int corner = 0; corner < 8; ++corner) {
+        itk::Point<double, 3> point;
+        for (int i = 0; i < 3; ++i) {
+            point[i] = (corner >> i) & 1 ? upper[i] : lower[i];
+        }
+        itk::ContinuousIndex<double, 3> index;
+        img->TransformPhysicalPointToContinuousIndex(point, index);
+        for (int i = 0; i < 3; ++i) {
+            low[i] = std::min(low[i], index[i]);
+            high[i] = std::max(high[i], index[i]);
+        }
+    }
+
+    // Centers on a face of the box are inside (up to the rounding of the index transform)
+    constexpr double tolerance = 1e-6;
+    const typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
+    typename itk::Image<PixelType, 3>::IndexType first;
+    typename itk::Image<PixelType, 3>::SizeType region_size;
+    for (int i = 0; i < 3; ++i) {
+        const long begin = std::max(static_cast<long>(std::ceil(low[i] - tolerance)), 0L);
+        const long end = std::min(static_cast<long>(std::floor(high[i] + tolerance)) + 1, static_cast<long>(size[i]));
+        first[i] = std::min(begin, static_cast<long>(size[i]));
+        region_size[i] = static_cast<std::size_t>(std::max(end - first[i], 0L));
+    }
+    return typename itk::Image<PixelType, 3>::RegionType(first, region_size);
+}
+
+
 #define PIXEL_TYPE_IMAGE(T) \
-    template itk::Image<T, 3>::Pointer panorama::resampling_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img); \
+    template itk::Image<T, 3>::Pointer panorama::resampling_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img, const ResampleKernel &kernel); \
     template itk::Image<T, 3>::Pointer panorama::window_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img); \
-    template itk::Image<T, 3>::Pointer panorama::extract_slices<T>(const typename itk::Image<T, 3>::Pointer &img, const std::pair<short, short> &range); \
+    template void panorama::window_ct_image_inplace<T>(const typename itk::Image<T, 3>::Pointer &img); \
+    template itk::Image<T, 3>::Pointer panorama::extract_slices<T>(const typename itk::Image<T, 3>::Pointer &img, const std::pair<short, short> &range, const bool &copy); \
+    template itk::Image<T, 3>::RegionType panorama::calc_head_region<T>(const typename itk::Image<T, 3>::Pointer &img, const T &threshold, const std::size_t &step, const std::size_t &margin); \
+    template itk::Image<T, 3>::Pointer panorama::crop_image<T>(const typename itk::Image<T, 3>::Pointer &img, const typename itk::Image<T, 3>::RegionType &region); \
     template itk::Image<T, 3>::Pointer panorama::rotate_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img, const char &axis, const double &angle); \
-    
+    template itk::Image<T, 3>::Pointer panorama::transform_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img, const itk::Matrix<double, 3, 3> &pose, const std::pair<short, short> &range, const RotationEngine &engine); \
+    template itk::Image<T, 3>::Pointer panorama::transform_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img, const itk::Matrix<double, 3, 3> &pose, const typename itk::Image<T, 3>::RegionType &region, const RotationEngine &engine); \
+    template itk::Image<T, 3>::RegionType panorama::calc_output_region<T>(const typename itk::Image<T, 3>::Pointer &img, const itk::Point<double, 3> &lower, const itk::Point<double, 3> &upper);
+
 PIXEL_TYPE_IMAGE(double)
-PIXEL_TYPE_IMAGE(short)
\ No newline at end of file
+PIXEL_TYPE_IMAGE(short)
@@ -1,4 +1,8 @@
 #include "../../include/image/io.hpp"
+#include "../../include/image/nifti.hpp"
+
+#include <algorithm>
+#include <limits>
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
@@ -9,6 +13,9 @@
 /**
  * itkImage reader
  *
+ * Uncompressed NIfTI volumes stored as PixelType are memory-mapped instead of decoded,
+ * BGZF-compressed ones are inflated in parallel.
+ *
  * @tparam PixelType
  * @tparam DIM
  * @param path
@@ -18,6 +25,16 @@ template <typename PixelType, int DIM>
 typename itk::Image<PixelType, DIM>::Pointer panorama::read_image(
         const std::string& path
 ) {
+    if constexpr (DIM == 3) {
+        const auto all = std::make_pair<short, short>(0, std::numeric_limits<short>::max());
+        if (auto img = map_nifti_image<PixelType>(path, all)) {
+            return img;
+        }
+        if (auto img = read_bgzf_nifti_image<PixelType>(path, all)) {
+            return img;
+        }
+    }
+
     // Initialize image reader
     auto reader = itk::ImageFileReader< itk::Image<PixelType, DIM> >::New();
     reader->SetFileName(path);
@@ -33,14 +50,106 @@ typename itk::Image<PixelType, DIM>::Pointer panorama::read_image(
 }
 
 
+/**
+ * itkImage reader for a z-range [first, second) of a 3D volume
+ *
+ * Only the requested slices are decoded (streamed through the ImageIO),
+ * mapped for uncompressed NIfTI files, or inflated block-wise for BGZF ones.
+ * The returned image is re-based: its regions start at index 0 and its
+ * origin is the physical position of the first slice read.
+ *
+ * @tparam PixelType
+ * @param path
+ * @param range
+ * @return
+ */
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer panorama::read_image_region(
+        const std::string& path,
+        const std::pair<short, short>& range
+) {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    if (auto img = map_nifti_image<PixelType>(path, range)) {
+        return img;
+    }
+    if (auto img = read_bgzf_nifti_image<PixelType>(path, range)) {
+        return img;
+    }
+
+    auto reader = itk::ImageFileReader<ImageType>::New();
+    reader->SetFileName(path);
+
+    try {
+        reader->UpdateOutputInformation();
+
+        const typename ImageType::RegionType largest = reader->GetOutput()->GetLargestPossibleRegion();
+        const long slice_num = static_cast<long>(largest.GetSize(2));
+        const long As = std::max<long>(range.first, 0);
+        const long Ae = std::max<long>(std::min<long>(range.second, slice_num), As);
+
+        typename ImageType::RegionType requested = largest;
+        requested.SetIndex(2, As);
+        requested.SetSize(2, Ae - As);
+
+        reader->GetOutput()->SetRequestedRegion(requested);
+        reader->Update();
+    } catch (itk::ExceptionObject &err) {
+        std::cerr << "Catch exception: " << std::endl << err << std::endl;
+        return nullptr;
+    }
+
+    typename ImageType::Pointer img = reader->GetOutput();
+    img->DisconnectPipeline();
+
+    // Re-base the slab so every kernel can treat it as a whole volume
+    typename ImageType::PointType origin;
+    img->TransformIndexToPhysicalPoint(img->GetBufferedRegion().GetIndex(), origin);
+
+    typename ImageType::RegionType region;
+    region.SetSize(img->GetBufferedRegion().GetSize());
+    img->SetRegions(region);
+    img->SetOrigin(origin);
+
+    return img;
+}
+
+
+/**
+ * Volume size from the file header (no voxel data is read)
+ *
+ * @tparam PixelType
+ * @param path
+ * @return
+ */
+template <typename PixelType>
+std::array<size_t, 3> panorama::read_image_size(
+        const std::string& path
+) {
+    auto reader = itk::ImageFileReader< itk::Image<PixelType, 3> >::New();
+    reader->SetFileName(path);
+
+    try {
+        reader->UpdateOutputInformation();
+    } catch (itk::ExceptionObject &err) {
+        std::cerr << "Catch exception: " << std::endl << err << std::endl;
+        return std::array<size_t, 3>{0, 0, 0};
+    }
+
+    const auto size = reader->GetOutput()->GetLargestPossibleRegion().GetSize();
+    return std::array<size_t, 3>{size[0], size[1], size[2]};
+}
+
+
 /**
  * itkImage writer
  *
  * @tparam PixelType
  * @tparam DIM
+ * @return false if ITK could not write the file (the exception is printed)
  */
 template <typename PixelType, int DIM>
-void panorama::write_image(
+bool panorama::write_image(
         const typename itk::Image<PixelType, DIM>::Pointer& img,
         const std::string& path
 ) {
@@ -58,9 +167,11 @@ void panorama::write_image(
 
     try {
         writer->Update();
-    } catch (itk::ImageFileWriterException& e) {
+    } catch (itk::ExceptionObject& e) {
         std::cerr << "Catch exception: " << std::endl << e << std::endl;
+        return false;
     }
+    return true;
 }
 
 
@@ -127,8 +238,10 @@ panorama::get_region(const typename itk::Image<PixelType, 3>::Pointer &img) {
 #define PIXEL_TYPE_IMAGE_IO(T)\
     template itk::Image<T, 3>::Pointer panorama::read_image<T, 3>(const std::string& path); \
     template itk::Image<T, 2>::Pointer panorama::read_image<T, 2>(const std::string& path); \
-    template void panorama::write_image<T, 3>(const itk::Image<T, 3>::Pointer &img, const std::string& path); \
-    template void panorama::write_image<T, 2>(const itk::Image<T, 2>::Pointer &img, const std::string& path); \
+    template itk::Image<T, 3>::Pointer panorama::read_image_region<T>(const std::string& path, const std::pair<short, short>& range); \
+    template std::array<size_t, 3> panorama::read_image_size<T>(const std::string& path); \
+    template bool panorama::write_image<T, 3>(const itk::Image<T, 3>::Pointer &img, const std::string& path); \
+    template bool panorama::write_image<T, 2>(const itk::Image<T, 2>::Pointer &img, const std::string& path); \
     template std::array<size_t, 3> panorama::get_size<T>(const itk::Image<T, 3>::Pointer &img); \
     template std::array<double, 3> panorama::get_spacing<T>(const itk::Image<T, 3>::Pointer &img);
 
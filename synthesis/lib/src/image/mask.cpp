@@ -1,4 +1,9 @@
 #include "../../include/image/mask.hpp"
+#include "../../include/image/mat.hpp"
+#include "../../include/image/pool.hpp"
+
+#include <algorithm>
+#include <type_traits>
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
@@ -7,6 +12,36 @@
 #include <opencv2/opencv.hpp>
 
 
+namespace {
+    // Rows of `width` values -> BitMask, bit set where `set(value)`
+    template <typename T, typename Predicate>
+    panorama::BitMask pack_rows(const T* src, const std::size_t& width, const std::size_t& height, const Predicate& set) {
+        panorama::BitMask mask;
+        mask.width = width;
+        mask.height = height;
+        mask.words_per_row = (width + 63) / 64;
+        mask.words.assign(mask.words_per_row * height, 0);
+
+        #pragma omp parallel for schedule(static) if (width * height >= (std::size_t(1) << 18))
+        for (std::size_t y = 0; y < height; ++y) {
+            const T* row = src + y * width;
+            std::uint64_t* words = mask.words.data() + y * mask.words_per_row;
+            for (std::size_t i = 0; i < mask.words_per_row; ++i) {
+                const std::size_t x0 = i * 64;
+                const std::size_t n = std::min<std::size_t>(64, width - x0);
+                std::uint64_t bits = 0;
+                #pragma omp simd reduction(|:bits)
+                for (std::size_t b = 0; b < n; ++b) {
+                    bits |= static_cast<std::uint64_t>(set(row[x0 + b])) << b;
+                }
+                words[i] = bits;
+            }
+        }
+        return mask;
+    }
+}
+
+
 // Thresholding Image → Binary Mask (value if > threshold, 0 otherwise)
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer
@@ -26,38 +61,100 @@ panorama::compute_mask_image(
 
     auto img2d = itk::Image<PixelType, 2>::New();
     img2d->SetRegions(region);
-    img2d->Allocate();
-    img2d->FillBuffer(0);
+    allocate_image<PixelType, 2>(img2d);
 
     // Apply thresholding
-    for (std::size_t x = 0; x < size[0]; ++x) {
-        for (std::size_t y = 0; y < size[1]; ++y) {
-            typename itk::Image<PixelType, 2>::IndexType idx;
-            idx[0] = x;
-            idx[1] = y;
-
-            const auto value = img->GetPixel(idx);
-            img2d->SetPixel(idx, value > threshold ? threshold : 0);
-        }
+    const PixelType* src = img->GetBufferPointer();
+    PixelType* dst = img2d->GetBufferPointer();
+    const std::size_t num = size[0] * size[1];
+    for (std::size_t i = 0; i < num; ++i) {
+        dst[i] = src[i] > threshold ? threshold : 0;
     }
 
     return img2d;
 }
 
 
+// Thresholding Image → 8-bit Mask (255 if > threshold, 0 otherwise)
+template <typename PixelType>
+panorama::MaskImage::Pointer
+panorama::compute_binary_mask(
+    const typename itk::Image<PixelType, 2>::Pointer& img,
+    const PixelType& threshold
+) {
+    const auto size = img->GetLargestPossibleRegion().GetSize();
+
+    MaskImage::RegionType region;
+    region.SetSize(size);
+
+    auto mask = MaskImage::New();
+    mask->SetRegions(region);
+    mask->SetSpacing(img->GetSpacing());
+    mask->SetOrigin(img->GetOrigin());
+    mask->SetDirection(img->GetDirection());
+    allocate_image<unsigned char, 2>(mask);
+
+    const PixelType* src = img->GetBufferPointer();
+    unsigned char* dst = mask->GetBufferPointer();
+    const std::size_t num = size[0] * size[1];
+    #pragma omp simd
+    for (std::size_t i = 0; i < num; ++i) {
+        dst[i] = src[i] > threshold ? 255 : 0;
+    }
+
+    return mask;
+}
+
+
+// Thresholding Image → Bit-packed Mask (set if > threshold)
+template <typename PixelType>
+panorama::BitMask
+panorama::compute_bit_mask(
+    const typename itk::Image<PixelType, 2>::Pointer& img,
+    const PixelType& threshold
+) {
+    const auto size = img->GetLargestPossibleRegion().GetSize();
+    return pack_rows(img->GetBufferPointer(), size[0], size[1], [&](const PixelType& value) { return value > threshold; });
+}
+
+
+// 8-bit Mask → Bit-packed Mask (set if nonzero)
+panorama::BitMask
+panorama::pack_mask(const MaskImage::Pointer& mask) {
+    const auto size = mask->GetLargestPossibleRegion().GetSize();
+    return pack_rows(mask->GetBufferPointer(), size[0], size[1], [](const unsigned char& value) { return value != 0; });
+}
+
+
+// Mask Image → 8-bit Binary
+template <typename PixelType>
+cv::Mat
+panorama::binarize_mask(const typename itk::Image<PixelType, 2>::Pointer& img) {
+    const cv::Mat img_cv = as_mat<PixelType>(img);
+
+    cv::Mat binary;
+    if constexpr (std::is_same<PixelType, unsigned char>::value) {
+        cv::threshold(img_cv, binary, 0, 255, cv::THRESH_BINARY);
+    } else {
+        // Mask pixels are 0 or positive integers for every PixelType: saturate foreground to 255
+        cv::Mat img_8bit;
+        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
+
+        // Binarize with Otsu's method
+        cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    }
+    return binary;
+}
+
+
 // Process Jaw Mask (Axial MIP)
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer 
 panorama::process_jaw_mask(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    typename itk::Image<PixelType, 2>::SizeType size_cv = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size_cv[1], size_cv[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), img->GetBufferPointer());
-
-    cv::Mat img_8bit;
-    img_cv.convertTo(img_8bit, CV_8UC1);
+    const cv::Mat img_cv = as_mat<PixelType>(img);
 
-    // Binarize with Otsu's method
-    cv::Mat binary;
-    cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    // Binarize (Otsu's method unless the mask is 8-bit)
+    cv::Mat binary = binarize_mask<PixelType>(img);
 
     // Find external contours
     std::vector<std::vector<cv::Point>> contours;
@@ -121,19 +218,7 @@ panorama::process_jaw_mask(const typename itk::Image<PixelType, 2>::Pointer& img
         cv::GaussianBlur(final_contour_img, final_contour_img, cv::Size(5, 5), 2.0);
 
         // Convert to ITK image
-        auto contour_itkImg = itk::Image<PixelType, 2>::New();
-        contour_itkImg->SetRegions(img->GetLargestPossibleRegion());
-        contour_itkImg->Allocate();
-        contour_itkImg->FillBuffer(0);
-
-        for (int y = 0; y < final_contour_img.rows; ++y) {
-            for (int x = 0; x < final_contour_img.cols; ++x) {
-                contour_itkImg->SetPixel(
-                    {static_cast<long int>(x), static_cast<long int>(y)},
-                    static_cast<PixelType>(final_contour_img.at<uchar>(y, x))
-                );
-            }
-        }
+        auto contour_itkImg = as_image<PixelType>(final_contour_img, img);
 
         return contour_itkImg;
     }
@@ -146,24 +231,11 @@ panorama::process_jaw_mask(const typename itk::Image<PixelType, 2>::Pointer& img
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer
 panorama::process_tooth_mask(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    // Convert ITK image to OpenCV format
-    typename itk::Image<PixelType, 2>::SizeType size_itk = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> itkIter(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++itkIter) {
-            img_cv.at<PixelType>(y, x) = itkIter.Get();
-        }
-    }
-
-    // Convert to 8-bit image
-    cv::Mat img_8bit;
-    img_cv.convertTo(img_8bit, CV_8UC1);
+    // View ITK image as OpenCV format
+    const cv::Mat img_cv = as_mat<PixelType>(img);
 
-    // Binarization using Otsu's method
-    cv::Mat binary;
-    cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    // Binarize (Otsu's method unless the mask is 8-bit)
+    cv::Mat binary = binarize_mask<PixelType>(img);
 
     // Detect contours
     std::vector<std::vector<cv::Point>> contours;
@@ -219,17 +291,7 @@ panorama::process_tooth_mask(const typename itk::Image<PixelType, 2>::Pointer& i
         cv::drawContours(mask, draw_contours, -1, cv::Scalar(255), cv::FILLED);
 
         // Convert the mask back to ITK format
-        auto mask_itkImg = itk::Image<PixelType, 2>::New();
-        mask_itkImg->SetRegions(img->GetLargestPossibleRegion());
-        mask_itkImg->Allocate();
-        mask_itkImg->FillBuffer(0);
-
-        itk::ImageRegionIterator<itk::Image<PixelType, 2>> maskItkIter(mask_itkImg, mask_itkImg->GetLargestPossibleRegion());
-        for (int y = 0; y < mask.rows; ++y) {
-            for (int x = 0; x < mask.cols; ++x, ++maskItkIter) {
-                maskItkIter.Set(static_cast<PixelType>(mask.at<uchar>(y, x)));
-            }
-        }
+        auto mask_itkImg = as_image<PixelType>(mask, img);
 
         return mask_itkImg;
     }
@@ -241,8 +303,12 @@ panorama::process_tooth_mask(const typename itk::Image<PixelType, 2>::Pointer& i
 
 #define PIXEL_TYPE_MASK(T) \
     template itk::Image<T, 2>::Pointer panorama::compute_mask_image<T>(const typename itk::Image<T, 2>::Pointer &img, const T &threshold); \
+    template panorama::MaskImage::Pointer panorama::compute_binary_mask<T>(const typename itk::Image<T, 2>::Pointer &img, const T &threshold); \
+    template panorama::BitMask panorama::compute_bit_mask<T>(const typename itk::Image<T, 2>::Pointer &img, const T &threshold); \
+    template cv::Mat panorama::binarize_mask<T>(const typename itk::Image<T, 2>::Pointer &img); \
     template itk::Image<T, 2>::Pointer panorama::process_jaw_mask<T>(const typename itk::Image<T, 2>::Pointer &img); \
     template itk::Image<T, 2>::Pointer panorama::process_tooth_mask<T>(const typename itk::Image<T, 2>::Pointer &img);
 
 PIXEL_TYPE_MASK(double)
-PIXEL_TYPE_MASK(short)
\ No newline at end of file
+PIXEL_TYPE_MASK(short)
+PIXEL_TYPE_MASK(unsigned char)
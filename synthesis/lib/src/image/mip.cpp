@@ -1,22 +1,46 @@
 #include "../../include/image/mip.hpp"
+#include "../../include/image/pool.hpp"
+#include "../../include/image/core.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkNiftiImageIO.h>
 
+
+// Max commutes with the (monotonic) HU clamp, so windowing the projection equals projecting the windowed volume
+template <typename PixelType>
+void clamp_mip_image(const typename itk::Image<PixelType, 2>::Pointer &img2d) {
+    const std::size_t pixels = img2d->GetLargestPossibleRegion().GetNumberOfPixels();
+    PixelType* buffer = img2d->GetBufferPointer();
+
+    #pragma omp simd
+    for (std::size_t i = 0; i < pixels; ++i) {
+        buffer[i] = panorama::clamp_hu(buffer[i]);
+    }
+}
+
 // CT -> CoronalMIP
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer 
-panorama::compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img) {
+panorama::compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img, const bool &clamp) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
     // Define region for the 2D image
     typename itk::Image<PixelType, 2>::IndexType start;
     start[0] = 0;
     start[1] = 0;
 
     typename itk::Image<PixelType, 2>::SizeType size;
-    size[0] = img->GetLargestPossibleRegion().GetSize(0);
-    size[1] = img->GetLargestPossibleRegion().GetSize(2);
+    size[0] = nx;
+    size[1] = nz;
 
     typename itk::Image<PixelType, 2>::RegionType region;
     region.SetSize(size);
@@ -24,33 +48,34 @@ panorama::compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Poi
 
     auto img2d = itk::Image<PixelType, 2>::New();
     img2d->SetRegions(region);
-    img2d->Allocate();
+    allocate_image<PixelType, 2>(img2d);
+
+    if (ny == 0) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* mip = img2d->GetBufferPointer();
 
     // Compute MIP (Maximum Intensity Projection)
-    double mip_value = 0;
-    for (std::size_t x = 0; x < img->GetLargestPossibleRegion().GetSize(0); ++x) {
-        for (std::size_t z = 0; z < img->GetLargestPossibleRegion().GetSize(2); ++z) {
-            for (std::size_t y = 0; y < img->GetLargestPossibleRegion().GetSize(1); ++y) {
-                typename itk::Image<PixelType, 3>::IndexType idx3;
-                idx3[0] = x;
-                idx3[1] = y;
-                idx3[2] = z;
-
-                const auto pixel_value = img->GetPixel(idx3);
-                if (y == 0) {
-                    mip_value = pixel_value;
-                } else if (mip_value < pixel_value) {
-                    mip_value = pixel_value;
-                }
+    // Each z slab reduces its rows over y into its own output row
+    #pragma omp parallel for schedule(static)
+    for (std::size_t z = 0; z < nz; ++z) {
+        const PixelType* slice = buffer + z * nx * ny;
+        PixelType* mip_row = mip + z * nx;
+
+        std::copy(slice, slice + nx, mip_row);
+        for (std::size_t y = 1; y < ny; ++y) {
+            const PixelType* row = slice + y * nx;
+            #pragma omp simd
+            for (std::size_t x = 0; x < nx; ++x) {
+                mip_row[x] = std::max(mip_row[x], row[x]);
             }
-
-            typename itk::Image<PixelType, 2>::IndexType idx2;
-            idx2[0] = x;
-            idx2[1] = z;
-            img2d->SetPixel(idx2, mip_value);
         }
     }
 
+    if (clamp) clamp_mip_image<PixelType>(img2d);
     return img2d;
 }
 
@@ -58,15 +83,20 @@ panorama::compute_coronal_mip_image(const typename itk::Image<PixelType, 3>::Poi
 // CT -> AxialMIP
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer 
-panorama::compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img) {
+panorama::compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img, const bool &clamp) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
     // Define region for the 2D image
     typename itk::Image<PixelType, 2>::IndexType start;
     start[0] = 0;
     start[1] = 0;
 
     typename itk::Image<PixelType, 2>::SizeType size;
-    size[0] = img->GetLargestPossibleRegion().GetSize(0);
-    size[1] = img->GetLargestPossibleRegion().GetSize(1);
+    size[0] = nx;
+    size[1] = ny;
 
     typename itk::Image<PixelType, 2>::RegionType region;
     region.SetSize(size);
@@ -74,33 +104,88 @@ panorama::compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Point
 
     auto img2d = itk::Image<PixelType, 2>::New();
     img2d->SetRegions(region);
-    img2d->Allocate();
+    allocate_image<PixelType, 2>(img2d);
+
+    if (nz == 0) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    const std::size_t plane = nx * ny;
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* mip = img2d->GetBufferPointer();
 
     // Compute MIP (Maximum Intensity Projection)
-    double mip_value = 0;
-    for (std::size_t x = 0; x < img->GetLargestPossibleRegion().GetSize(0); ++x) {
-        for (std::size_t y = 0; y < img->GetLargestPossibleRegion().GetSize(1); ++y) {
-            for (std::size_t z = 0; z < img->GetLargestPossibleRegion().GetSize(2); ++z) {
-                typename itk::Image<PixelType, 3>::IndexType idx3;
-                idx3[0] = x;
-                idx3[1] = y;
-                idx3[2] = z;
-
-                auto pixel_value = img->GetPixel(idx3);
-                if (z == 0) {
-                    mip_value = pixel_value;
-                } else if (mip_value < pixel_value) {
-                    mip_value = pixel_value;
-                }
+    // Threads stream over contiguous z slabs into private planes, merged at the end
+    std::copy(buffer, buffer + plane, mip);
+
+    #pragma omp parallel
+    {
+        std::vector<PixelType> partial(plane, std::numeric_limits<PixelType>::lowest());
+
+        #pragma omp for schedule(static) nowait
+        for (std::size_t z = 1; z < nz; ++z) {
+            const PixelType* slice = buffer + z * plane;
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i) {
+                partial[i] = std::max(partial[i], slice[i]);
             }
+        }
+
+        #pragma omp critical
+        {
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i) {
+                mip[i] = std::max(mip[i], partial[i]);
+            }
+        }
+    }
+
+    if (clamp) clamp_mip_image<PixelType>(img2d);
+    return img2d;
+}
+
+
+// Posed CT -> AxialMIP
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer
+panorama::compute_axial_mip_image(const TransformedVolume<PixelType> &view, const bool &clamp) {
+    const auto size3d = view.size();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
 
-            typename itk::Image<PixelType, 2>::IndexType idx2;
-            idx2[0] = x;
-            idx2[1] = y;
-            img2d->SetPixel(idx2, mip_value);
+    typename itk::Image<PixelType, 2>::SizeType size;
+    size[0] = nx;
+    size[1] = ny;
+
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size);
+
+    auto img2d = itk::Image<PixelType, 2>::New();
+    img2d->SetRegions(region);
+    allocate_image<PixelType, 2>(img2d);
+
+    if (nz == 0) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    PixelType* mip = img2d->GetBufferPointer();
+
+    // Output rows are independent: each reduces its scanline over every slice
+    #pragma omp parallel for schedule(static)
+    for (std::size_t y = 0; y < ny; ++y) {
+        PixelType* mip_row = mip + y * nx;
+        std::fill(mip_row, mip_row + nx, std::numeric_limits<PixelType>::lowest());
+        for (std::size_t z = 0; z < nz; ++z) {
+            for (std::size_t x = 0; x < nx; ++x) {
+                mip_row[x] = std::max(mip_row[x], view.sample(static_cast<double>(x), static_cast<double>(y), static_cast<double>(z)));
+            }
         }
     }
 
+    if (clamp) clamp_mip_image<PixelType>(img2d);
     return img2d;
 }
 
@@ -108,15 +193,20 @@ panorama::compute_axial_mip_image(const typename itk::Image<PixelType, 3>::Point
 // CT -> SagittalMIP
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer 
-panorama::compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img) {
+panorama::compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Pointer &img, const bool &clamp) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
     // Define region for the 2D image
     typename itk::Image<PixelType, 2>::IndexType start;
     start[0] = 0;
     start[1] = 0;
 
     typename itk::Image<PixelType, 2>::SizeType size;
-    size[0] = img->GetLargestPossibleRegion().GetSize(1);
-    size[1] = img->GetLargestPossibleRegion().GetSize(2);
+    size[0] = ny;
+    size[1] = nz;
 
     typename itk::Image<PixelType, 2>::RegionType region;
     region.SetSize(size);
@@ -124,65 +214,330 @@ panorama::compute_sagittal_mip_image(const typename itk::Image<PixelType, 3>::Po
 
     auto img2d = itk::Image<PixelType, 2>::New();
     img2d->SetRegions(region);
-    img2d->Allocate();
+    allocate_image<PixelType, 2>(img2d);
+
+    if (nx == 0) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* mip = img2d->GetBufferPointer();
 
     // Compute MIP (Maximum Intensity Projection)
-    double mip_value = 0;
-    for (std::size_t z = 0; z < img->GetLargestPossibleRegion().GetSize(2); ++z) {
-        for (std::size_t y = 0; y < img->GetLargestPossibleRegion().GetSize(1); ++y) {
-            for (std::size_t x = 0; x < img->GetLargestPossibleRegion().GetSize(0); ++x) {
-                typename itk::Image<PixelType, 3>::IndexType idx3;
-                idx3[0] = x;
-                idx3[1] = y;
-                idx3[2] = z;
-
-                auto pixel_value = img->GetPixel(idx3);
-                if (x == 0) {
-                    mip_value = pixel_value;
-                } else if (mip_value < pixel_value) {
-                    mip_value = pixel_value;
-                }
+    // Every row is reduced over x into one output pixel; z slabs write disjoint output rows
+    #pragma omp parallel for schedule(static)
+    for (std::size_t z = 0; z < nz; ++z) {
+        for (std::size_t y = 0; y < ny; ++y) {
+            const PixelType* row = buffer + (z * ny + y) * nx;
+            PixelType mip_value = row[0];
+            #pragma omp simd reduction(max:mip_value)
+            for (std::size_t x = 1; x < nx; ++x) {
+                mip_value = std::max(mip_value, row[x]);
             }
+            mip[z * ny + y] = mip_value;
+        }
+    }
+
+    if (clamp) clamp_mip_image<PixelType>(img2d);
+    return img2d;
+}
 
-            typename itk::Image<PixelType, 2>::IndexType idx2;
-            idx2[0] = y;
-            idx2[1] = z;
-            img2d->SetPixel(idx2, mip_value);
+
+// Posed CT -> SagittalMIP
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer
+panorama::compute_sagittal_mip_image(const TransformedVolume<PixelType> &view, const bool &clamp) {
+    const auto size3d = view.size();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
+    typename itk::Image<PixelType, 2>::SizeType size;
+    size[0] = ny;
+    size[1] = nz;
+
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size);
+
+    auto img2d = itk::Image<PixelType, 2>::New();
+    img2d->SetRegions(region);
+    allocate_image<PixelType, 2>(img2d);
+
+    if (nx == 0) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    PixelType* mip = img2d->GetBufferPointer();
+
+    // Every scanline is reduced over x into one output pixel
+    #pragma omp parallel for schedule(static)
+    for (std::size_t z = 0; z < nz; ++z) {
+        for (std::size_t y = 0; y < ny; ++y) {
+            PixelType mip_value = std::numeric_limits<PixelType>::lowest();
+            for (std::size_t x = 0; x < nx; ++x) {
+                mip_value = std::max(mip_value, view.sample(static_cast<double>(x), static_cast<double>(y), static_cast<double>(z)));
+            }
+            mip[z * ny + y] = mip_value;
         }
     }
 
+    if (clamp) clamp_mip_image<PixelType>(img2d);
     return img2d;
 }
 
 
 template <typename PixelType>
-PixelType panorama::get_max_pixel_value(const typename itk::Image<PixelType, 3>::Pointer &img) {
-    typename itk::Image<PixelType, 3>::SizeType size = img->GetLargestPossibleRegion().GetSize();
+PixelType panorama::get_max_pixel_value(const typename itk::Image<PixelType, 3>::Pointer &img, const bool &clamp) {
+    const std::size_t voxels = img->GetLargestPossibleRegion().GetNumberOfPixels();
+    const PixelType* buffer = img->GetBufferPointer();
     PixelType max_pixel_value = std::numeric_limits<PixelType>::lowest();
 
-    for (std::size_t x = 0; x < size[0]; ++x) {
-        for (std::size_t y = 0; y < size[1]; ++y) {
-            for (std::size_t z = 0; z < size[2]; ++z) {
-                typename itk::Image<PixelType, 3>::IndexType idx;
-                idx[0] = x;
-                idx[1] = y;
-                idx[2] = z;
-
-                auto pixel_value = img->GetPixel(idx);
-                if (pixel_value > max_pixel_value) {
-                    max_pixel_value = pixel_value;
+    #pragma omp parallel for simd schedule(static) reduction(max:max_pixel_value)
+    for (std::size_t i = 0; i < voxels; ++i) {
+        max_pixel_value = std::max(max_pixel_value, buffer[i]);
+    }
+
+    return clamp ? clamp_hu(max_pixel_value) : max_pixel_value;
+}
+
+// CT -> Axial, Coronal and SagittalMIP in a single pass
+template <typename PixelType>
+panorama::OrthogonalMIPs<PixelType>
+panorama::compute_orthogonal_mips(const typename itk::Image<PixelType, 3>::Pointer &img, const bool &clamp) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
+    auto allocate = [](const std::size_t& width, const std::size_t& height) {
+        typename itk::Image<PixelType, 2>::IndexType start;
+        start[0] = 0;
+        start[1] = 0;
+
+        typename itk::Image<PixelType, 2>::SizeType size;
+        size[0] = width;
+        size[1] = height;
+
+        typename itk::Image<PixelType, 2>::RegionType region;
+        region.SetSize(size);
+        region.SetIndex(start);
+
+        auto img2d = itk::Image<PixelType, 2>::New();
+        img2d->SetRegions(region);
+        allocate_image<PixelType, 2>(img2d);
+        img2d->FillBuffer(0);
+        return img2d;
+    };
+
+    OrthogonalMIPs<PixelType> mips;
+    mips.axial = allocate(nx, ny);
+    mips.coronal = allocate(nx, nz);
+    mips.sagittal = allocate(ny, nz);
+    mips.max_value = 0;
+
+    if (nx == 0 || ny == 0 || nz == 0) {
+        return mips;
+    }
+
+    const std::size_t plane = nx * ny;
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* axial = mips.axial->GetBufferPointer();
+    PixelType* coronal = mips.coronal->GetBufferPointer();
+    PixelType* sagittal = mips.sagittal->GetBufferPointer();
+    PixelType max_value = std::numeric_limits<PixelType>::lowest();
+
+    // Every row is read once: it updates coronal row z and the thread's axial plane,
+    // and its own max becomes one sagittal pixel. The global max falls out of the sagittal rows.
+    std::copy(buffer, buffer + plane, axial);
+
+    #pragma omp parallel reduction(max:max_value)
+    {
+        std::vector<PixelType> partial(plane, std::numeric_limits<PixelType>::lowest());
+
+        #pragma omp for schedule(static) nowait
+        for (std::size_t z = 0; z < nz; ++z) {
+            const PixelType* slice = buffer + z * plane;
+            PixelType* coronal_row = coronal + z * nx;
+            PixelType* sagittal_row = sagittal + z * ny;
+
+            std::copy(slice, slice + nx, coronal_row);
+            for (std::size_t y = 0; y < ny; ++y) {
+                const PixelType* row = slice + y * nx;
+                PixelType* partial_row = partial.data() + y * nx;
+                PixelType row_max = row[0];
+                #pragma omp simd reduction(max:row_max)
+                for (std::size_t x = 0; x < nx; ++x) {
+                    const PixelType value = row[x];
+                    const PixelType coronal_value = coronal_row[x];
+                    const PixelType partial_value = partial_row[x];
+                    coronal_row[x] = std::max(coronal_value, value);
+                    partial_row[x] = std::max(partial_value, value);
+                    row_max = std::max(row_max, value);
                 }
+                sagittal_row[y] = row_max;
+                max_value = std::max(max_value, row_max);
+            }
+        }
+
+        #pragma omp critical
+        {
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i) {
+                axial[i] = std::max(axial[i], partial[i]);
+            }
+        }
+    }
+
+    mips.max_value = max_value;
+    if (clamp) {
+        clamp_mip_image<PixelType>(mips.axial);
+        clamp_mip_image<PixelType>(mips.coronal);
+        clamp_mip_image<PixelType>(mips.sagittal);
+        mips.max_value = clamp_hu(max_value);
+    }
+    return mips;
+}
+
+
+// CT -> AxialMIPIndex
+template <typename PixelType>
+panorama::AxialMIPIndex<PixelType>::AxialMIPIndex(
+    const typename itk::Image<PixelType, 3>::Pointer &img,
+    const std::size_t &block_slices
+) : img(img), block_slices(std::max<std::size_t>(block_slices, 1)) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    nx = size3d[0];
+    ny = size3d[1];
+    nz = size3d[2];
+    plane = nx * ny;
+    block_num = nz / this->block_slices;
+
+    if (block_num == 0) return;
+
+    // Level 0: max over each whole block (the incomplete last block is always read from the volume)
+    const PixelType* buffer = img->GetBufferPointer();
+    table.emplace_back(block_num * plane);
+    std::vector<PixelType>& base = table[0];
+    const long blocks = static_cast<long>(block_num);
+
+    #pragma omp parallel for schedule(static)
+    for (long b = 0; b < blocks; ++b) {
+        const PixelType* slab = buffer + b * this->block_slices * plane;
+        PixelType* out = base.data() + b * plane;
+        std::copy(slab, slab + plane, out);
+        for (std::size_t z = 1; z < this->block_slices; ++z) {
+            const PixelType* slice = slab + z * plane;
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i) {
+                out[i] = std::max(out[i], slice[i]);
             }
         }
     }
 
-    return max_pixel_value;
+    // Level k: max of two overlapping level k-1 entries
+    for (std::size_t span = 2; span <= block_num; span *= 2) {
+        const std::vector<PixelType>& prev = table.back();
+        std::vector<PixelType> level((block_num - span + 1) * plane);
+        const long entries = static_cast<long>(block_num - span + 1);
+
+        #pragma omp parallel for schedule(static)
+        for (long b = 0; b < entries; ++b) {
+            const PixelType* lo = prev.data() + b * plane;
+            const PixelType* hi = prev.data() + (b + span / 2) * plane;
+            PixelType* out = level.data() + b * plane;
+            #pragma omp simd
+            for (std::size_t i = 0; i < plane; ++i) {
+                out[i] = std::max(lo[i], hi[i]);
+            }
+        }
+        table.push_back(std::move(level));
+    }
+}
+
+
+// AxialMIPIndex -> AxialMIP of slices [first, second)
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer
+panorama::AxialMIPIndex<PixelType>::query(const std::pair<short, short> &range, const bool &clamp) const {
+    const std::size_t As = static_cast<std::size_t>(std::max<long>(range.first, 0));
+    const std::size_t Ae = static_cast<std::size_t>(std::min<long>(std::max<long>(range.second, 0), static_cast<long>(nz)));
+
+    typename itk::Image<PixelType, 2>::SizeType size;
+    size[0] = nx;
+    size[1] = ny;
+
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size);
+
+    auto img2d = itk::Image<PixelType, 2>::New();
+    img2d->SetRegions(region);
+    allocate_image<PixelType, 2>(img2d);
+
+    if (As >= Ae) {
+        img2d->FillBuffer(0);
+        return img2d;
+    }
+
+    // Source planes: slices outside whole blocks, plus at most two table entries covering the rest
+    const PixelType* buffer = img->GetBufferPointer();
+    std::vector<const PixelType*> sources;
+    const std::size_t b0 = (As + block_slices - 1) / block_slices;
+    const std::size_t b1 = std::min(Ae / block_slices, block_num);
+
+    if (b0 < b1) {
+        std::size_t k = 0;
+        while ((std::size_t(2) << k) <= b1 - b0) ++k;
+        sources.push_back(table[k].data() + b0 * plane);
+        sources.push_back(table[k].data() + (b1 - (std::size_t(1) << k)) * plane);
+        for (std::size_t z = As; z < b0 * block_slices; ++z) sources.push_back(buffer + z * plane);
+        for (std::size_t z = b1 * block_slices; z < Ae; ++z) sources.push_back(buffer + z * plane);
+    } else {
+        for (std::size_t z = As; z < Ae; ++z) sources.push_back(buffer + z * plane);
+    }
+
+    // Merge in cache-sized pixel chunks, all sources per chunk
+    PixelType* mip = img2d->GetBufferPointer();
+    const std::size_t chunk = 4096;
+    const long chunks = static_cast<long>((plane + chunk - 1) / chunk);
+
+    #pragma omp parallel for schedule(static)
+    for (long c = 0; c < chunks; ++c) {
+        const std::size_t begin = c * chunk;
+        const std::size_t end = std::min(begin + chunk, plane);
+        std::copy(sources[0] + begin, sources[0] + end, mip + begin);
+        for (std::size_t s = 1; s < sources.size(); ++s) {
+            const PixelType* src = sources[s];
+            #pragma omp simd
+            for (std::size_t i = begin; i < end; ++i) {
+                mip[i] = std::max(mip[i], src[i]);
+            }
+        }
+    }
+
+    if (clamp) clamp_mip_image<PixelType>(img2d);
+    return img2d;
+}
+
+
+template <typename PixelType>
+std::size_t panorama::AxialMIPIndex<PixelType>::memory_size() const {
+    std::size_t bytes = 0;
+    for (const auto& level : table) {
+        bytes += level.size() * sizeof(PixelType);
+    }
+    return bytes;
 }
 
 #define PIXEL_TYPE_MIP(T) \
-    template itk::Image<T, 2>::Pointer panorama::compute_coronal_mip_image<T>(const itk::Image<T, 3>::Pointer &img); \
-    template itk::Image<T, 2>::Pointer panorama::compute_axial_mip_image<T>(const itk::Image<T, 3>::Pointer &img); \
-    template itk::Image<T, 2>::Pointer panorama::compute_sagittal_mip_image<T>(const itk::Image<T, 3>::Pointer &img); \
-    template T panorama::get_max_pixel_value<T>(const itk::Image<T, 3>::Pointer &img);
+    template itk::Image<T, 2>::Pointer panorama::compute_coronal_mip_image<T>(const itk::Image<T, 3>::Pointer &img, const bool &clamp); \
+    template itk::Image<T, 2>::Pointer panorama::compute_axial_mip_image<T>(const itk::Image<T, 3>::Pointer &img, const bool &clamp); \
+    template itk::Image<T, 2>::Pointer panorama::compute_sagittal_mip_image<T>(const itk::Image<T, 3>::Pointer &img, const bool &clamp); \
+    template itk::Image<T, 2>::Pointer panorama::compute_axial_mip_image<T>(const panorama::TransformedVolume<T> &view, const bool &clamp); \
+    template itk::Image<T, 2>::Pointer panorama::compute_sagittal_mip_image<T>(const panorama::TransformedVolume<T> &view, const bool &clamp); \
+    template T panorama::get_max_pixel_value<T>(const itk::Image<T, 3>::Pointer &img, const bool &clamp); \
+    template panorama::OrthogonalMIPs<T> panorama::compute_orthogonal_mips<T>(const itk::Image<T, 3>::Pointer &img, const bool &clamp); \
+    template class panorama::AxialMIPIndex<T>;
 PIXEL_TYPE_MIP(double)
-PIXEL_TYPE_MIP(short)
\ No newline at end of file
+PIXEL_TYPE_MIP(short)
@@ -0,0 +1,382 @@
+#include "../../include/image/nifti.hpp"
+#include "../../include/image/pool.hpp"
+#include "../../include/image/bgzf.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImportImageContainer.h>
+
+
+namespace panorama {
+    // Pixel container over a private file mapping: in-place edits (e.g. windowing) copy the
+    // touched pages and never reach the file. The mapping is released with the container.
+    template <typename TElementIdentifier, typename TElement>
+    class MappedImageContainer : public itk::ImportImageContainer<TElementIdentifier, TElement> {
+    public:
+        ITK_DISALLOW_COPY_AND_MOVE(MappedImageContainer);
+
+        using Self = MappedImageContainer;
+        using Superclass = itk::ImportImageContainer<TElementIdentifier, TElement>;
+        using Pointer = itk::SmartPointer<Self>;
+        using ConstPointer = itk::SmartPointer<const Self>;
+
+        itkNewMacro(Self);
+
+        void SetMapping(void* address, const std::size_t& length) {
+            m_Address = address;
+            m_Length = length;
+        }
+
+    protected:
+        MappedImageContainer() = default;
+        ~MappedImageContainer() override {
+            if (m_Address) {
+                munmap(m_Address, m_Length);
+            }
+        }
+
+    private:
+        void* m_Address = nullptr;
+        std::size_t m_Length = 0;
+    };
+}
+
+
+static bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool panorama::is_uncompressed_nifti(const std::string& path) {
+    return ends_with(path, ".nii");
+}
+
+bool panorama::is_compressed_nifti(const std::string& path) {
+    return ends_with(path, ".nii.gz");
+}
+
+
+// Raw 348-byte header -> NIfTI-1 header fields (3D volumes only)
+static bool parse_nifti_header(const char* raw, panorama::NiftiHeader& header) {
+    std::int32_t sizeof_hdr;
+    std::memcpy(&sizeof_hdr, raw, sizeof(sizeof_hdr));
+    if (sizeof_hdr != 348) {
+        std::reverse(reinterpret_cast<char*>(&sizeof_hdr), reinterpret_cast<char*>(&sizeof_hdr) + sizeof(sizeof_hdr));
+        if (sizeof_hdr != 348) {
+            return false;
+        }
+        header.swapped = true;
+    } else {
+        header.swapped = false;
+    }
+
+    // Single-file NIfTI-1 ("n+1"); header/image pairs ("ni1") are not handled here
+    if (std::memcmp(raw + 344, "n+1", 4) != 0) {
+        return false;
+    }
+
+    auto field = [&](const std::size_t& offset, auto value) {
+        std::memcpy(&value, raw + offset, sizeof(value));
+        if (header.swapped) {
+            std::reverse(reinterpret_cast<char*>(&value), reinterpret_cast<char*>(&value) + sizeof(value));
+        }
+        return value;
+    };
+
+    const short ndim = field(40, short{});
+    if (ndim < 1 || ndim > 7) {
+        return false;
+    }
+    for (short i = 0; i < 3; ++i) {
+        header.size[i] = i < ndim ? static_cast<std::size_t>(field(42 + 2 * i, short{})) : 1;
+    }
+    for (short i = 3; i < ndim; ++i) {
+        if (field(42 + 2 * i, short{}) > 1) {
+            return false;
+        }
+    }
+
+    for (short i = 0; i < 3; ++i) {
+        header.spacing[i] = field(80 + 4 * i, float{});
+    }
+    header.datatype = field(70, short{});
+    header.bitpix = field(72, short{});
+    header.vox_offset = static_cast<std::size_t>(field(108, float{}));
+    header.scl_slope = field(112, float{});
+    header.scl_inter = field(116, float{});
+
+    return true;
+}
+
+// .nii / .nii.gz -> NIfTI-1 header fields (zlib reads uncompressed files as they are)
+bool panorama::read_nifti_header(const std::string& path, NiftiHeader& header) {
+    gzFile file = gzopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char raw[348];
+    const int n = gzread(file, raw, sizeof(raw));
+    gzclose(file);
+    return n == static_cast<int>(sizeof(raw)) && parse_nifti_header(raw, header);
+}
+
+
+// Stored values must already be PixelType values (scl_slope == 0 means unscaled)
+template <typename PixelType>
+static bool is_native_layout(const panorama::NiftiHeader& header) {
+    // NIFTI_TYPE_INT16 / NIFTI_TYPE_FLOAT64
+    constexpr short datatype = std::is_same<PixelType, short>::value ? 4 : std::is_same<PixelType, double>::value ? 64 : 0;
+
+    return !header.swapped && header.datatype == datatype && header.bitpix == 8 * sizeof(PixelType) &&
+           (header.scl_slope == 0 || header.scl_slope == 1) && header.scl_inter == 0 &&
+           header.vox_offset % alignof(PixelType) == 0;
+}
+
+
+// Geometry exactly as the ITK reader reports it; nullptr if it disagrees with the header
+template <typename PixelType>
+static typename itk::Image<PixelType, 3>::Pointer
+read_nifti_information(const std::string& path, const panorama::NiftiHeader& header) {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    auto reader = itk::ImageFileReader<ImageType>::New();
+    reader->SetFileName(path);
+    try {
+        reader->UpdateOutputInformation();
+    } catch (itk::ExceptionObject &err) {
+        std::cerr << "Catch exception: " << std::endl << err << std::endl;
+        return nullptr;
+    }
+    typename ImageType::Pointer info = reader->GetOutput();
+
+    const typename ImageType::SizeType size = info->GetLargestPossibleRegion().GetSize();
+    for (unsigned int i = 0; i < 3; ++i) {
+        if (size[i] != header.size[i]) {
+            return nullptr;
+        }
+    }
+    return info;
+}
+
+
+// Slices [first, second) of `info` as an image starting at index 0 (no buffer yet)
+template <typename PixelType>
+static typename itk::Image<PixelType, 3>::Pointer
+make_slab_image(const typename itk::Image<PixelType, 3>::Pointer& info, const long& first, const long& second) {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    typename ImageType::IndexType first_slice;
+    first_slice[0] = 0;
+    first_slice[1] = 0;
+    first_slice[2] = first;
+
+    typename ImageType::PointType origin;
+    info->TransformIndexToPhysicalPoint(first_slice, origin);
+
+    typename ImageType::SizeType size = info->GetLargestPossibleRegion().GetSize();
+    size[2] = second - first;
+    typename ImageType::RegionType region;
+    region.SetSize(size);
+
+    auto img = ImageType::New();
+    img->SetRegions(region);
+    img->SetSpacing(info->GetSpacing());
+    img->SetOrigin(origin);
+    img->SetDirection(info->GetDirection());
+    return img;
+}
+
+
+// .nii -> itkImage sharing the file pages (slices [first, second))
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::map_nifti_image(const std::string& path, const std::pair<short, short>& range) {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    NiftiHeader header;
+    if (!is_uncompressed_nifti(path) || !read_nifti_header(path, header) || !is_native_layout<PixelType>(header)) {
+        return nullptr;
+    }
+
+    typename ImageType::Pointer info = read_nifti_information<PixelType>(path, header);
+    if (!info) {
+        return nullptr;
+    }
+
+    const long slice_num = static_cast<long>(header.size[2]);
+    const long As = std::max<long>(range.first, 0);
+    const long Ae = std::max<long>(std::min<long>(range.second, slice_num), As);
+    const std::size_t plane = header.size[0] * header.size[1];
+    const std::size_t voxels = plane * (Ae - As);
+    if (voxels == 0) {
+        return nullptr;
+    }
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < header.vox_offset + plane * slice_num * sizeof(PixelType)) {
+        close(fd);
+        return nullptr;
+    }
+
+    // Map from the page holding the first kept voxel
+    const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t begin = header.vox_offset + As * plane * sizeof(PixelType);
+    const std::size_t map_begin = begin / page * page;
+    const std::size_t map_length = begin - map_begin + voxels * sizeof(PixelType);
+
+    void* address = mmap(nullptr, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(map_begin));
+    close(fd);
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto container = MappedImageContainer<itk::SizeValueType, PixelType>::New();
+    container->SetImportPointer(
+        reinterpret_cast<PixelType*>(static_cast<char*>(address) + (begin - map_begin)), voxels, false
+    );
+    container->SetMapping(address, map_length);
+
+    typename ImageType::Pointer img = make_slab_image<PixelType>(info, As, Ae);
+    img->SetPixelContainer(container);
+
+    return img;
+}
+
+
+// BGZF .nii.gz -> itkImage (slices [first, second)), only the blocks holding them are inflated
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::read_bgzf_nifti_image(const std::string& path, const std::pair<short, short>& range) {
+    using ImageType = itk::Image<PixelType, 3>;
+
+    if (!is_compressed_nifti(path) || !is_bgzf(path)) {
+        return nullptr;
+    }
+
+    char raw[348];
+    NiftiHeader header;
+    if (!inflate_bgzf(path, 0, sizeof(raw), raw) || !parse_nifti_header(raw, header) ||
+        !is_native_layout<PixelType>(header)) {
+        return nullptr;
+    }
+
+    typename ImageType::Pointer info = read_nifti_information<PixelType>(path, header);
+    if (!info) {
+        return nullptr;
+    }
+
+    const long slice_num = static_cast<long>(header.size[2]);
+    const long As = std::max<long>(range.first, 0);
+    const long Ae = std::max<long>(std::min<long>(range.second, slice_num), As);
+    const std::size_t plane = header.size[0] * header.size[1];
+    const std::size_t voxels = plane * (Ae - As);
+    if (voxels == 0) {
+        return nullptr;
+    }
+
+    typename ImageType::Pointer img = make_slab_image<PixelType>(info, As, Ae);
+    allocate_image<PixelType, 3>(img);
+
+    const std::size_t begin = header.vox_offset + As * plane * sizeof(PixelType);
+    if (!inflate_bgzf(path, begin, voxels * sizeof(PixelType), reinterpret_cast<char*>(img->GetBufferPointer()))) {
+        std::cerr << "[WARNING] failed to inflate " << path << std::endl;
+        return nullptr;
+    }
+
+    return img;
+}
+
+
+// .nii.gz -> cached .nii
+std::string panorama::cache_nifti(const std::string& path, const std::string& cache_dir) {
+    namespace fs = boost::filesystem;
+
+    if (!is_compressed_nifti(path)) {
+        return path;
+    }
+
+    const fs::path source(path);
+    const fs::path target = fs::path(cache_dir) / source.stem();   // "xxx.nii.gz" -> "xxx.nii"
+
+    boost::system::error_code ec;
+    if (fs::exists(target, ec) && fs::last_write_time(target, ec) >= fs::last_write_time(source, ec)) {
+        return target.string();
+    }
+    fs::create_directories(cache_dir, ec);
+
+    // Decompress under a unique name and rename, so concurrent jobs never see a partial file
+    const fs::path temporary = target.string() + "." + fs::unique_path().string() + ".tmp";
+
+    std::ofstream out(temporary.string(), std::ios::binary);
+    bool ok = static_cast<bool>(out);
+
+    if (const std::size_t size = is_bgzf(path) ? bgzf_size(path) : 0) {
+        // BGZF: blocks inflated in parallel, 64 MiB at a time
+        std::vector<char> buffer(std::min<std::size_t>(size, std::size_t(64) << 20));
+        for (std::size_t pos = 0; ok && pos < size; pos += buffer.size()) {
+            const std::size_t n = std::min(buffer.size(), size - pos);
+            ok = inflate_bgzf(path, pos, n, buffer.data()) && out.write(buffer.data(), static_cast<std::streamsize>(n));
+        }
+    } else {
+        gzFile in = gzopen(path.c_str(), "rb");
+        if (in == nullptr) {
+            std::cerr << "[WARNING] cannot open " << path << std::endl;
+            out.close();
+            fs::remove(temporary, ec);
+            return path;
+        }
+        gzbuffer(in, 1 << 20);
+
+        std::vector<char> buffer(1 << 20);
+        int n = 0;
+        while (out && (n = gzread(in, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0) {
+            out.write(buffer.data(), n);
+        }
+        gzclose(in);
+        ok = n >= 0;
+    }
+    out.close();
+
+    if (!ok || !out) {
+        std::cerr << "[WARNING] failed to decompress " << path << std::endl;
+        fs::remove(temporary, ec);
+        return path;
+    }
+
+    fs::rename(temporary, target, ec);
+    if (ec) {
+        std::cerr << "[WARNING] failed to cache " << path << ": " << ec.message() << std::endl;
+        fs::remove(temporary, ec);
+        return path;
+    }
+
+    return target.string();
+}
+
+#define PIXEL_TYPE_NIFTI(T) \
+    template itk::Image<T, 3>::Pointer panorama::map_nifti_image<T>(const std::string& path, const std::pair<short, short>& range); \
+    template itk::Image<T, 3>::Pointer panorama::read_bgzf_nifti_image<T>(const std::string& path, const std::pair<short, short>& range);
+PIXEL_TYPE_NIFTI(double)
+PIXEL_TYPE_NIFTI(short)
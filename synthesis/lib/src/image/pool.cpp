@@ -0,0 +1,96 @@
+#include "../../include/image/pool.hpp"
+
+#include <algorithm>
+
+#include <sys/mman.h>
+
+
+// Size class of a request: multiples of a quarter of its power of two, at least 2 MiB
+static std::size_t bucket_size(const std::size_t& bytes) {
+    constexpr std::size_t HUGE_PAGE = std::size_t(2) << 20;
+
+    std::size_t power = HUGE_PAGE;
+    while (power < bytes) {
+        power <<= 1;
+    }
+    const std::size_t step = std::max(power / 4, HUGE_PAGE);
+    return (bytes + step - 1) / step * step;
+}
+
+
+panorama::BufferPool& panorama::BufferPool::instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+
+panorama::BufferPool::~BufferPool() {
+    trim();
+}
+
+
+void* panorama::BufferPool::acquire(const std::size_t& bytes, std::size_t& capacity) {
+    capacity = bucket_size(bytes);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = buffers.find(capacity);
+        if (it != buffers.end()) {
+            void* buffer = it->second;
+            buffers.erase(it);
+            cached -= capacity;
+            return buffer;
+        }
+    }
+
+    void* buffer = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(buffer, capacity, MADV_HUGEPAGE);
+#endif
+    return buffer;
+}
+
+
+void panorama::BufferPool::release(void* buffer, const std::size_t& capacity) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cached + capacity <= limit) {
+            buffers.emplace(capacity, buffer);
+            cached += capacity;
+            return;
+        }
+    }
+    munmap(buffer, capacity);
+}
+
+
+void panorama::BufferPool::set_limit(const std::size_t& bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = bytes;
+    }
+    if (cached_bytes() > bytes) {
+        trim();
+    }
+}
+
+
+std::size_t panorama::BufferPool::cached_bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached;
+}
+
+
+void panorama::BufferPool::trim() {
+    std::multimap<std::size_t, void*> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released.swap(buffers);
+        cached = 0;
+    }
+    for (const auto& [capacity, buffer] : released) {
+        munmap(buffer, capacity);
+    }
+}
@@ -0,0 +1,319 @@
+#include "../../include/image/resample.hpp"
+#include "../../include/image/pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <itkImage.h>
+
+
+namespace {
+    // Output slices resampled together along z (the ring holds the input planes one slab reads)
+    constexpr long SLAB = 32;
+
+    // 1-D resampling of one axis: output o = sum_k weight[o * width + k] * input[index[o * width + k]]
+    struct AxisWeights {
+        long width = 0;
+        std::vector<long> index;
+        std::vector<double> weight;
+        std::vector<char> inside;   // false: no input under the output voxel, the output is 0
+        bool identity = true;       // output o = input o
+
+        // Two taps are blended as in ITK's linear interpolator, v0 + w1 * (v1 - v0)
+        bool linear() const { return width == 2; }
+    };
+
+    // Catmull-Rom (Keys, a = -0.5)
+    double cubic(const double& distance) {
+        const double t = std::abs(distance);
+        if (t < 1) return (1.5 * t - 2.5) * t * t + 1;
+        if (t < 2) return ((-0.5 * t + 2.5) * t - 4) * t + 2;
+        return 0;
+    }
+
+    long floor_long(const double& value) {
+        return static_cast<long>(std::floor(value));
+    }
+
+    // Output o of m samples the input (n voxels) at index o * scale; indices are clamped to the edge voxels
+    AxisWeights calc_axis_weights(const long& n, const long& m, const double& scale, const panorama::ResampleKernel& kernel) {
+        const bool box = kernel == panorama::ResampleKernel::Box && scale > 1;
+
+        AxisWeights axis;
+        axis.width = box ? static_cast<long>(std::ceil(scale)) + 1 : kernel == panorama::ResampleKernel::Cubic ? 4 : 2;
+        axis.index.assign(m * axis.width, 0);
+        axis.weight.assign(m * axis.width, 0.0);
+        axis.inside.assign(m, 0);
+        axis.identity = m == n;
+
+        auto clamp_index = [&](const long& i) { return std::min(std::max(i, 0L), n - 1); };
+        for (long o = 0; o < m; ++o) {
+            const double c = o * scale;
+            long* index = axis.index.data() + o * axis.width;
+            double* weight = axis.weight.data() + o * axis.width;
+
+            if (c < -0.5 || c >= n - 0.5) {
+                axis.identity = false;
+                continue;
+            }
+            axis.inside[o] = 1;
+
+            if (box) {
+                // Overlap of [c - scale / 2, c + scale / 2] (clipped to the volume) with each voxel
+                const double low = std::max(c - scale / 2, -0.5);
+                const double high = std::min(c + scale / 2, n - 0.5);
+                const long first = floor_long(low + 0.5);
+                double total = 0;
+                for (long k = 0; k < axis.width; ++k) {
+                    const long i = first + k;
+                    index[k] = clamp_index(i);
+                    weight[k] = std::max(0.0, std::min(high, i + 0.5) - std::max(low, i - 0.5));
+                    total += weight[k];
+                }
+                for (long k = 0; k < axis.width; ++k) {
+                    weight[k] /= total;
+                }
+            } else {
+                const long i0 = floor_long(c);
+                const double f = c - i0;
+                if (axis.width == 4) {
+                    for (long k = 0; k < 4; ++k) {
+                        index[k] = clamp_index(i0 - 1 + k);
+                        weight[k] = cubic(f + 1 - k);
+                    }
+                } else {
+                    index[0] = clamp_index(i0);
+                    index[1] = clamp_index(i0 + 1);
+                    weight[0] = 1 - f;
+                    weight[1] = f;
+                }
+            }
+
+            double self = 0;
+            for (long k = 0; k < axis.width; ++k) {
+                if (index[k] == o) {
+                    self += weight[k];
+                } else if (weight[k] != 0) {
+                    axis.identity = false;
+                }
+            }
+            axis.identity = axis.identity && self == 1;
+        }
+        return axis;
+    }
+
+    // Cast like the resampler (clamped to the pixel range, truncated)
+    template <typename PixelType>
+    inline PixelType cast_pixel(const double& value) {
+        if (std::is_integral<PixelType>::value) {
+            return static_cast<PixelType>(std::min(std::max(value, static_cast<double>(std::numeric_limits<PixelType>::lowest())),
+                                                   static_cast<double>(std::numeric_limits<PixelType>::max())));
+        }
+        return static_cast<PixelType>(value);
+    }
+
+    // dst[j] = output o of the axis, blended from the n-value rows row(index) for j < n
+    // (sum: n doubles of scratch for kernels wider than two taps)
+    template <typename T, typename Row>
+    void blend_rows(T* dst, const AxisWeights& axis, const long& o, const std::size_t& n, const Row& row, double* sum) {
+        if (!axis.inside[o]) {
+            std::fill(dst, dst + n, T(0));
+            return;
+        }
+        const long* index = axis.index.data() + o * axis.width;
+        const double* weight = axis.weight.data() + o * axis.width;
+
+        if (axis.linear()) {
+            const double* r0 = row(index[0]);
+            const double* r1 = row(index[1]);
+            const double w = weight[1];
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) {
+                dst[j] = cast_pixel<T>(r0[j] + w * (r1[j] - r0[j]));
+            }
+            return;
+        }
+
+        const double* r0 = row(index[0]);
+        const double w0 = weight[0];
+        #pragma omp simd
+        for (std::size_t j = 0; j < n; ++j) {
+            sum[j] = w0 * r0[j];
+        }
+        for (long k = 1; k < axis.width; ++k) {
+            const double* r = row(index[k]);
+            const double w = weight[k];
+            #pragma omp simd
+            for (std::size_t j = 0; j < n; ++j) {
+                sum[j] += w * r[j];
+            }
+        }
+        #pragma omp simd
+        for (std::size_t j = 0; j < n; ++j) {
+            dst[j] = cast_pixel<T>(sum[j]);
+        }
+    }
+
+    // dst[o] = output o of the axis from one input row of PixelType values
+    template <typename PixelType>
+    void resample_row(double* dst, const PixelType* src, const AxisWeights& axis, const long& m) {
+        if (axis.identity) {
+            std::copy(src, src + m, dst);
+            return;
+        }
+        for (long o = 0; o < m; ++o) {
+            if (!axis.inside[o]) {
+                dst[o] = 0;
+                continue;
+            }
+            const long* index = axis.index.data() + o * axis.width;
+            const double* weight = axis.weight.data() + o * axis.width;
+            if (axis.linear()) {
+                const double v0 = src[index[0]];
+                dst[o] = v0 + weight[1] * (src[index[1]] - v0);
+            } else {
+                double sum = 0;
+                for (long k = 0; k < axis.width; ++k) {
+                    sum += weight[k] * src[index[k]];
+                }
+                dst[o] = sum;
+            }
+        }
+    }
+}
+
+
+// Isotropic (or any axis-aligned) resampling with three separable passes
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::resample_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const typename itk::Image<PixelType, 3>::SpacingType& spacing,
+    const ResampleKernel& kernel
+) {
+    const auto input_size = img->GetLargestPossibleRegion().GetSize();
+    const auto input_spacing = img->GetSpacing();
+
+    typename itk::Image<PixelType, 3>::SizeType size;
+    long n[3], m[3];
+    double scale[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+        size[i] = static_cast<unsigned int>(input_size[i] * (input_spacing[i] / spacing[i]));
+        n[i] = static_cast<long>(input_size[i]);
+        m[i] = static_cast<long>(size[i]);
+        scale[i] = spacing[i] / input_spacing[i];
+    }
+
+    typename itk::Image<PixelType, 3>::RegionType region;
+    region.SetSize(size);
+
+    auto out = itk::Image<PixelType, 3>::New();
+    out->SetRegions(region);
+    out->SetSpacing(spacing);
+    out->SetOrigin(img->GetOrigin());
+    out->SetDirection(img->GetDirection());
+    allocate_image<PixelType, 3>(out);
+
+    if (m[0] == 0 || m[1] == 0 || m[2] == 0) {
+        return out;
+    }
+    if (n[0] == 0 || n[1] == 0 || n[2] == 0) {
+        out->FillBuffer(0);
+        return out;
+    }
+
+    const AxisWeights ax = calc_axis_weights(n[0], m[0], scale[0], kernel);
+    const AxisWeights ay = calc_axis_weights(n[1], m[1], scale[1], kernel);
+    const AxisWeights az = calc_axis_weights(n[2], m[2], scale[2], kernel);
+
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* dst = out->GetBufferPointer();
+    if (ax.identity && ay.identity && az.identity) {
+        std::copy(buffer, buffer + img->GetLargestPossibleRegion().GetNumberOfPixels(), dst);
+        return out;
+    }
+
+    // Input planes [first, last) read by each slab of output slices; the ring holds the widest span
+    const long slabs = (m[2] + SLAB - 1) / SLAB;
+    std::vector<long> plane_first(slabs), plane_last(slabs);
+    long capacity = 1;
+    for (long s = 0; s < slabs; ++s) {
+        long first = n[2], last = 0;
+        for (long o = s * SLAB; o < std::min((s + 1) * SLAB, m[2]); ++o) {
+            if (!az.inside[o]) continue;
+            for (long k = 0; k < az.width; ++k) {
+                first = std::min(first, az.index[o * az.width + k]);
+                last = std::max(last, az.index[o * az.width + k] + 1);
+            }
+        }
+        plane_first[s] = first;
+        plane_last[s] = std::max(last, first);
+        capacity = std::max(capacity, plane_last[s] - plane_first[s]);
+    }
+
+    // x/y-resampled input planes, input plane z in slot z % capacity
+    const std::size_t input_plane = static_cast<std::size_t>(n[0]) * n[1];
+    const std::size_t plane = static_cast<std::size_t>(m[0]) * m[1];
+    std::vector<double> ring(capacity * plane);
+    std::vector<long> ring_z(capacity, -1);
+    std::vector<long> missing;
+
+    #pragma omp parallel
+    {
+        // x-resampled rows of one input plane, blending scratch
+        std::vector<double> rows(ay.identity ? 0 : static_cast<std::size_t>(n[1]) * m[0]);
+        std::vector<double> sum(m[0]);
+
+        for (long s = 0; s < slabs; ++s) {
+            #pragma omp single
+            {
+                missing.clear();
+                for (long z = plane_first[s]; z < plane_last[s]; ++z) {
+                    if (ring_z[z % capacity] != z) missing.push_back(z);
+                }
+            }
+
+            // 1. + 2. x then y over each input plane the slab reads
+            #pragma omp for schedule(dynamic)
+            for (std::size_t p = 0; p < missing.size(); ++p) {
+                const long z = missing[p];
+                const PixelType* src = buffer + z * input_plane;
+                double* target = ring.data() + (z % capacity) * plane;
+
+                double* x_rows = ay.identity ? target : rows.data();
+                for (long y = 0; y < n[1]; ++y) {
+                    resample_row(x_rows + y * m[0], src + y * n[0], ax, m[0]);
+                }
+                if (!ay.identity) {
+                    for (long y = 0; y < m[1]; ++y) {
+                        blend_rows(target + y * m[0], ay, y, m[0], [&](const long& i) { return x_rows + i * m[0]; }, sum.data());
+                    }
+                }
+                ring_z[z % capacity] = z;
+            }
+
+            // 3. z over the output slices of the slab, row by row
+            const long o0 = s * SLAB;
+            const long slices = std::min(SLAB, m[2] - o0);
+            #pragma omp for collapse(2) schedule(static)
+            for (long o = o0; o < o0 + slices; ++o) {
+                for (long y = 0; y < m[1]; ++y) {
+                    blend_rows(dst + (o * m[1] + y) * m[0], az, o, m[0], [&](const long& i) {
+                        return ring.data() + (i % capacity) * plane + y * m[0];
+                    }, sum.data());
+                }
+            }
+        }
+    }
+
+    return out;
+}
+
+
+#define PIXEL_TYPE_RESAMPLE(T) \
+    template itk::Image<T, 3>::Pointer panorama::resample_image<T>(const typename itk::Image<T, 3>::Pointer &img, const typename itk::Image<T, 3>::SpacingType &spacing, const ResampleKernel &kernel);
+PIXEL_TYPE_RESAMPLE(double)
+PIXEL_TYPE_RESAMPLE(short)
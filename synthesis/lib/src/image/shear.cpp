@@ -0,0 +1,294 @@
+#include "../../include/image/shear.hpp"
+#include "../../include/image/core.hpp"
+#include "../../include/image/pool.hpp"
+#include "../../include/image/view.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <itkImage.h>
+
+
+namespace {
+    // x-columns rotated together when the axis is 'x' (x is then not a plane axis, so cells of
+    // LANES contiguous voxels, a cache line of shorts, are lerped instead of single voxels)
+    constexpr std::size_t LANES = 32;
+
+    template <typename T>
+    inline void lerp(double* dst, const T* src0, const T* src1, const double& f, const std::size_t& n) {
+        #pragma omp simd
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[i] = src0[i] + f * (static_cast<double>(src1[i]) - src0[i]);
+        }
+    }
+
+    // dst cell i = src at cell (first + i) + f, for i < count; cells are `lanes` values, `stride` apart
+    // in src, clamped to [0, n) as the resampler clamps edge voxels
+    template <typename T>
+    void shift_row(
+        double* dst, const T* src, const std::size_t& stride, const std::size_t& lanes,
+        const long& first, const long& count, const long& n, const double& f
+    ) {
+        auto cell = [&](const long& i) {
+            const long p = first + i;
+            const T* c0 = src + std::min(std::max(p, 0L), n - 1) * stride;
+            const T* c1 = src + std::min(std::max(p + 1, 0L), n - 1) * stride;
+            lerp(dst + i * lanes, c0, c1, f, lanes);
+        };
+
+        // Cells whose both neighbours are inside need no clamping
+        const long begin = std::min(std::max(-first, 0L), count);
+        const long end = std::max(std::min(n - 1 - first, count), begin);
+
+        for (long i = 0; i < begin; ++i) {
+            cell(i);
+        }
+        if (stride == lanes) {
+            const T* c0 = src + (first + begin) * static_cast<long>(stride);
+            lerp(dst + begin * lanes, c0, c0 + stride, f, (end - begin) * lanes);
+        } else {
+            for (long i = begin; i < end; ++i) {
+                cell(i);
+            }
+        }
+        for (long i = end; i < count; ++i) {
+            cell(i);
+        }
+    }
+
+    // Cast like the resampler (clamped to the pixel range, truncated)
+    template <typename PixelType>
+    inline PixelType cast_pixel(const double& value) {
+        if (std::is_integral<PixelType>::value) {
+            return static_cast<PixelType>(std::min(std::max(value, static_cast<double>(std::numeric_limits<PixelType>::lowest())),
+                                                   static_cast<double>(std::numeric_limits<PixelType>::max())));
+        }
+        return static_cast<PixelType>(value);
+    }
+
+    // Narrow [lo, hi) to the cells i with -0.5 <= slope * i + value < n - 0.5 (up to rounding, callers fix the ends)
+    void clip_run(const double& slope, const double& value, const long& n, double& lo, double& hi) {
+        const double low = -0.5 - value;
+        const double high = n - 0.5 - value;
+        if (slope > 0) {
+            lo = std::max(lo, low / slope);
+            hi = std::min(hi, high / slope);
+        } else if (slope < 0) {
+            lo = std::max(lo, high / slope);
+            hi = std::min(hi, low / slope);
+        } else if (low > 0 || high <= 0) {
+            hi = lo;
+        }
+    }
+
+    long floor_long(const double& value) {
+        return static_cast<long>(std::floor(value));
+    }
+}
+
+
+// Apply a single-axis pose with three shears per plane, producing only the voxels of region
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::shear_transform_ct_image(
+    const typename itk::Image<PixelType, 3>::Pointer& img,
+    const itk::Matrix<double, 3, 3>& pose,
+    const typename itk::Image<PixelType, 3>::RegionType& region
+) {
+    // Index-space map of the pose (output index -> input continuous index)
+    const TransformedVolume<PixelType> view(img, pose);
+    double offset[3], matrix[3][3];
+    view.map(0, 0, 0, offset);
+    for (int j = 0; j < 3; ++j) {
+        double unit[3] = {0, 0, 0}, index[3];
+        unit[j] = 1;
+        view.map(unit[0], unit[1], unit[2], index);
+        for (int i = 0; i < 3; ++i) {
+            matrix[i][j] = index[i] - offset[i];
+        }
+    }
+
+    // Rotation axis c: the index axis the map leaves untouched
+    int c = -1;
+    for (int k = 0; k < 3 && c < 0; ++k) {
+        const int i = (k + 1) % 3, j = (k + 2) % 3;
+        if (std::abs(matrix[k][k] - 1) < 1e-12 && std::abs(matrix[k][i]) < 1e-12 && std::abs(matrix[k][j]) < 1e-12 &&
+            std::abs(matrix[i][k]) < 1e-12 && std::abs(matrix[j][k]) < 1e-12 && std::abs(offset[k]) < 1e-9) {
+            c = k;
+        }
+    }
+    if (c < 0) {
+        return nullptr;
+    }
+    const int a = c == 0 ? 1 : 0;
+    const int b = c == 2 ? 1 : 2;
+
+    // In-plane map u = A v + o; A = [[1, alpha], [0, 1]] [[1, 0], [beta, 1]] [[1, gamma], [0, 1]]
+    const double A00 = matrix[a][a], A01 = matrix[a][b], A10 = matrix[b][a], A11 = matrix[b][b];
+    if (std::abs(A10) < 1e-12 || std::abs(A00 * A11 - A01 * A10 - 1) > 1e-9) {
+        return nullptr;
+    }
+    const double alpha = (A00 - 1) / A10;
+    const double beta = A10;
+    const double gamma = (A11 - 1) / A10;
+    const double oa = offset[a], ob = offset[b];
+
+    const auto size = img->GetLargestPossibleRegion().GetSize();
+    const long n[3] = {static_cast<long>(size[0]), static_cast<long>(size[1]), static_cast<long>(size[2])};
+    const std::size_t stride[3] = {1, size[0], size[0] * size[1]};
+    const long na = n[a], nb = n[b];
+    const std::size_t sa = stride[a], sb = stride[b], sc = stride[c];
+
+    // Output grid = input grid restricted to the region (as transform_ct_image)
+    typename itk::Image<PixelType, 3>::IndexType first;
+    typename itk::Image<PixelType, 3>::SizeType output_size;
+    long r0[3], r1[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+        r0[i] = std::min<long>(std::max<long>(region.GetIndex(i), 0), n[i]);
+        r1[i] = std::max(std::min<long>(region.GetIndex(i) + static_cast<long>(region.GetSize(i)), n[i]), r0[i]);
+        first[i] = r0[i];
+        output_size[i] = static_cast<std::size_t>(r1[i] - r0[i]);
+    }
+    const std::size_t output_stride[3] = {1, output_size[0], output_size[0] * output_size[1]};
+    const std::size_t osa = output_stride[a], osb = output_stride[b], osc = output_stride[c];
+    const long ra0 = r0[a], ra1 = r1[a], rb0 = r0[b], rb1 = r1[b];
+
+    typename itk::Image<PixelType, 3>::PointType output_origin;
+    img->TransformIndexToPhysicalPoint(first, output_origin);
+
+    typename itk::Image<PixelType, 3>::RegionType output_region;
+    output_region.SetSize(output_size);
+
+    auto out = itk::Image<PixelType, 3>::New();
+    out->SetRegions(output_region);
+    out->SetSpacing(img->GetSpacing());
+    out->SetOrigin(output_origin);
+    out->SetDirection(img->GetDirection());
+    allocate_image<PixelType, 3>(out);
+
+    if (output_region.GetNumberOfPixels() == 0) {
+        return out;
+    }
+
+    // Plane extents: J2 (after the first two passes) spans the a-cells read by the last pass,
+    // J1 (after the first pass) the b-cells read by the second one
+    const double reach = gamma * (nb - 1);
+    const long a0 = floor_long(std::min(0.0, reach));
+    const long plane_na = floor_long(na - 1 + std::max(0.0, reach)) + 2 - a0;
+    const double low = beta * (beta > 0 ? a0 : a0 + plane_na - 1) + ob;
+    const double high = beta * (beta > 0 ? a0 + plane_na - 1 : a0) + ob + nb - 1;
+    const long b0 = floor_long(low);
+    const long plane_nb = floor_long(high) + 2 - b0;
+
+    // Per a-cell shift of the second pass
+    std::vector<long> shift(plane_na);
+    std::vector<double> weight(plane_na);
+    for (long i = 0; i < plane_na; ++i) {
+        const double s = beta * (a0 + i) + ob - b0;
+        shift[i] = floor_long(s);
+        weight[i] = s - shift[i];
+    }
+
+    // Only the J1 rows the second pass reads for the output rows [rb0, rb1)
+    const long j1_first = std::max(rb0 + *std::min_element(shift.begin(), shift.end()), 0L);
+    const long j1_last = std::min(rb1 + *std::max_element(shift.begin(), shift.end()), plane_nb - 1);
+    const long j1_rows = std::max(j1_last - j1_first + 1, 0L);
+
+    const std::size_t width = c == 0 ? LANES : 1;
+    std::vector<double> j1(static_cast<std::size_t>(plane_na) * j1_rows * width);
+    std::vector<double> j2(static_cast<std::size_t>(plane_na) * (rb1 - rb0) * width);
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* dst = out->GetBufferPointer();
+
+    for (long c0 = r0[c]; c0 < r1[c]; c0 += static_cast<long>(width)) {
+        const std::size_t lanes = std::min<std::size_t>(width, r1[c] - c0);
+        const PixelType* plane = buffer + c0 * sc;
+        PixelType* out_plane = dst + (c0 - r0[c]) * osc;
+
+        #pragma omp parallel
+        {
+            // 1. J1(a, b) = I(a + alpha * b + oa - alpha * ob, b)
+            #pragma omp for schedule(static)
+            for (long j = j1_first; j <= j1_last; ++j) {
+                const long row = std::min(std::max(b0 + j, 0L), nb - 1);
+                const double s = alpha * (b0 + j) + oa - alpha * ob;
+                const long k = floor_long(s);
+                shift_row(j1.data() + (j - j1_first) * plane_na * lanes, plane + row * sb, sa, lanes, a0 + k, plane_na, na, s - k);
+            }
+
+            // 2. J2(a, b) = J1(a, b + beta * a + ob)
+            #pragma omp for schedule(static)
+            for (long j = rb0; j < rb1; ++j) {
+                double* row = j2.data() + (j - rb0) * plane_na * lanes;
+                for (long i = 0; i < plane_na; ++i) {
+                    const long q0 = std::min(std::max(j + shift[i], 0L), plane_nb - 1) - j1_first;
+                    const long q1 = std::min(std::max(j + shift[i] + 1, 0L), plane_nb - 1) - j1_first;
+                    lerp(row + i * lanes, j1.data() + (q0 * plane_na + i) * lanes,
+                         j1.data() + (q1 * plane_na + i) * lanes, weight[i], lanes);
+                }
+            }
+
+            // 3. O(a, b) = J2(a + gamma * b, b), 0 where the exact map leaves the volume
+            std::vector<double> values((ra1 - ra0) * lanes);
+            #pragma omp for schedule(static)
+            for (long j = rb0; j < rb1; ++j) {
+                const double s = gamma * j;
+                const long k = floor_long(s);
+                shift_row(values.data(), j2.data() + (j - rb0) * plane_na * lanes, lanes, lanes, k - a0 + ra0, ra1 - ra0, plane_na, s - k);
+
+                // Cells mapped inside the volume form one run [first, last) of the row
+                auto inside = [&](const long& i) {
+                    const double ua = A00 * i + A01 * j + oa;
+                    const double ub = A10 * i + A11 * j + ob;
+                    return ua >= -0.5 && ua < na - 0.5 && ub >= -0.5 && ub < nb - 0.5;
+                };
+                double lo = static_cast<double>(ra0), hi = static_cast<double>(ra1);
+                clip_run(A00, A01 * j + oa, na, lo, hi);
+                clip_run(A10, A11 * j + ob, nb, lo, hi);
+                long first = std::min(std::max(static_cast<long>(std::ceil(lo)), ra0), ra1);
+                long last = std::min(std::max(static_cast<long>(std::ceil(hi)), first), ra1);
+                while (first < last && !inside(first)) ++first;
+                while (first > ra0 && inside(first - 1)) --first;
+                while (last > first && !inside(last - 1)) --last;
+                while (last < ra1 && inside(last)) ++last;
+
+                PixelType* row = out_plane + (j - rb0) * osb;
+                auto clear = [&](const long& from, const long& to) {
+                    for (long i = from; i < to; ++i) {
+                        for (std::size_t l = 0; l < lanes; ++l) {
+                            row[(i - ra0) * osa + l * osc] = 0;
+                        }
+                    }
+                };
+                clear(ra0, first);
+                if (osa == lanes) {
+                    const std::size_t count = (last - first) * lanes;
+                    PixelType* cells = row + (first - ra0) * osa;
+                    const double* source = values.data() + (first - ra0) * lanes;
+                    #pragma omp simd
+                    for (std::size_t l = 0; l < count; ++l) {
+                        cells[l] = cast_pixel<PixelType>(source[l]);
+                    }
+                } else {
+                    for (long i = first; i < last; ++i) {
+                        for (std::size_t l = 0; l < lanes; ++l) {
+                            row[(i - ra0) * osa + l * osc] = cast_pixel<PixelType>(values[(i - ra0) * lanes + l]);
+                        }
+                    }
+                }
+                clear(last, ra1);
+            }
+        }
+    }
+
+    return out;
+}
+
+
+#define PIXEL_TYPE_SHEAR(T) \
+    template itk::Image<T, 3>::Pointer panorama::shear_transform_ct_image<T>(const typename itk::Image<T, 3>::Pointer &img, const itk::Matrix<double, 3, 3> &pose, const typename itk::Image<T, 3>::RegionType &region);
+PIXEL_TYPE_SHEAR(double)
+PIXEL_TYPE_SHEAR(short)
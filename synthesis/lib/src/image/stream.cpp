@@ -0,0 +1,162 @@
+#include "../../include/image/stream.hpp"
+#include "../../include/image/pool.hpp"
+#include "../../include/image/io.hpp"
+#include "../../include/image/mip.hpp"
+#include "../../include/image/nifti.hpp"
+#include "../../include/image/bgzf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+#include <itkImage.h>
+
+
+// CT file -> CoronalMIP (streamed over z slabs)
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer
+panorama::compute_coronal_mip_image(const std::string &path, const short &slab, const bool &clamp) {
+    const std::array<size_t, 3> size3d = read_image_size<PixelType>(path);
+    const std::size_t nx = size3d[0];
+    const std::size_t nz = size3d[2];
+
+    if (slab <= 0) {
+        throw std::invalid_argument("Slab size must be positive.");
+    }
+    if (nx == 0 || nz == 0) {
+        return nullptr;
+    }
+
+    // Only uncompressed and BGZF files can read a slab without decoding what precedes it;
+    // a plain gzip stream would be re-inflated from the start for every slab, so read it once instead
+    if (!is_uncompressed_nifti(path) && !is_bgzf(path)) {
+        auto img = read_image<PixelType>(path);
+        if (!img) {
+            return nullptr;
+        }
+        return compute_coronal_mip_image<PixelType>(img, clamp);
+    }
+
+    // Define region for the 2D image
+    typename itk::Image<PixelType, 2>::IndexType start;
+    start[0] = 0;
+    start[1] = 0;
+
+    typename itk::Image<PixelType, 2>::SizeType size;
+    size[0] = nx;
+    size[1] = nz;
+
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size);
+    region.SetIndex(start);
+
+    auto img2d = itk::Image<PixelType, 2>::New();
+    img2d->SetRegions(region);
+    allocate_image<PixelType, 2>(img2d);
+    img2d->FillBuffer(0);
+
+    PixelType* mip = img2d->GetBufferPointer();
+
+    // Each slab projects to its own band of output rows
+    for (std::size_t z = 0; z < nz; z += slab) {
+        const short As = static_cast<short>(z);
+        const short Ae = static_cast<short>(std::min<std::size_t>(z + slab, nz));
+
+        auto img_slab = read_image_region<PixelType>(path, std::make_pair(As, Ae));
+        if (!img_slab) {
+            return nullptr;
+        }
+
+        auto slab_mip = compute_coronal_mip_image<PixelType>(img_slab, clamp);
+        const PixelType* band = slab_mip->GetBufferPointer();
+        std::copy(band, band + nx * (Ae - As), mip + z * nx);
+    }
+
+    return img2d;
+}
+
+// CT file -> Axial, Coronal and SagittalMIP (streamed over z slabs, one sweep per slab)
+template <typename PixelType>
+panorama::OrthogonalMIPs<PixelType>
+panorama::compute_orthogonal_mips(const std::string &path, const short &slab, const bool &clamp) {
+    const std::array<size_t, 3> size3d = read_image_size<PixelType>(path);
+    const std::size_t nx = size3d[0];
+    const std::size_t ny = size3d[1];
+    const std::size_t nz = size3d[2];
+
+    if (slab <= 0) {
+        throw std::invalid_argument("Slab size must be positive.");
+    }
+    OrthogonalMIPs<PixelType> mips;
+    mips.max_value = 0;
+    if (nx == 0 || ny == 0 || nz == 0) {
+        return mips;
+    }
+
+    // Plain gzip: read once (see compute_coronal_mip_image)
+    if (!is_uncompressed_nifti(path) && !is_bgzf(path)) {
+        auto img = read_image<PixelType>(path);
+        if (!img) {
+            return mips;
+        }
+        return compute_orthogonal_mips<PixelType>(img, clamp);
+    }
+
+    auto allocate = [](const std::size_t& width, const std::size_t& height) {
+        typename itk::Image<PixelType, 2>::SizeType size;
+        size[0] = width;
+        size[1] = height;
+
+        typename itk::Image<PixelType, 2>::RegionType region;
+        region.SetSize(size);
+
+        auto img2d = itk::Image<PixelType, 2>::New();
+        img2d->SetRegions(region);
+        allocate_image<PixelType, 2>(img2d);
+        return img2d;
+    };
+
+    OrthogonalMIPs<PixelType> result;
+    result.coronal = allocate(nx, nz);
+    result.sagittal = allocate(ny, nz);
+    result.max_value = std::numeric_limits<PixelType>::lowest();
+
+    // Coronal and sagittal rows of each slab are its own band; axial planes and maxima are merged
+    for (std::size_t z = 0; z < nz; z += slab) {
+        const short As = static_cast<short>(z);
+        const short Ae = static_cast<short>(std::min<std::size_t>(z + slab, nz));
+
+        auto img_slab = read_image_region<PixelType>(path, std::make_pair(As, Ae));
+        if (!img_slab) {
+            return mips;
+        }
+
+        const OrthogonalMIPs<PixelType> slab_mips = compute_orthogonal_mips<PixelType>(img_slab, clamp);
+        const PixelType* coronal_band = slab_mips.coronal->GetBufferPointer();
+        const PixelType* sagittal_band = slab_mips.sagittal->GetBufferPointer();
+        std::copy(coronal_band, coronal_band + nx * (Ae - As), result.coronal->GetBufferPointer() + z * nx);
+        std::copy(sagittal_band, sagittal_band + ny * (Ae - As), result.sagittal->GetBufferPointer() + z * ny);
+        result.max_value = std::max(result.max_value, slab_mips.max_value);
+
+        if (!result.axial) {
+            result.axial = slab_mips.axial;
+            continue;
+        }
+        const PixelType* src = slab_mips.axial->GetBufferPointer();
+        PixelType* dst = result.axial->GetBufferPointer();
+        const long pixels = static_cast<long>(nx * ny);
+        #pragma omp parallel for simd schedule(static)
+        for (long i = 0; i < pixels; ++i) {
+            dst[i] = std::max(dst[i], src[i]);
+        }
+    }
+
+    return result;
+}
+
+#define PIXEL_TYPE_STREAM(T) \
+    template itk::Image<T, 2>::Pointer panorama::compute_coronal_mip_image<T>(const std::string &path, const short &slab, const bool &clamp); \
+    template panorama::OrthogonalMIPs<T> panorama::compute_orthogonal_mips<T>(const std::string &path, const short &slab, const bool &clamp);
+PIXEL_TYPE_STREAM(double)
+PIXEL_TYPE_STREAM(short)
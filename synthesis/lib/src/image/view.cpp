@@ -0,0 +1,187 @@
+#include "../../include/image/view.hpp"
+#include "../../include/image/pool.hpp"
+
+#include <itkImage.h>
+
+
+template <typename PixelType>
+panorama::TransformedVolume<PixelType>::TransformedVolume(
+    const typename ImageType::Pointer& img,
+    const itk::Matrix<double, 3, 3>& pose,
+    const std::pair<short, short>& range
+) : img(img), buffer(img->GetBufferPointer()) {
+    const typename ImageType::SpacingType spacing = img->GetSpacing();
+    input_size = img->GetLargestPossibleRegion().GetSize();
+
+    // Center of rotation = center of the full volume (continuous index size / 2), whatever slices are kept
+    double center[3];
+    for (int i = 0; i < 3; ++i) {
+        center[i] = input_size[i] / 2.0;
+    }
+
+    const short slice_num = static_cast<short>(input_size[2]);
+    const short As = std::max<short>(range.first, 0);
+    short Ae = std::min<short>(range.second, slice_num);
+    if (Ae < As) Ae = As;
+    first[0] = 0;
+    first[1] = 0;
+    first[2] = As;
+    output_size = input_size;
+    output_size[2] = Ae - As;
+
+    // output index -> pose (about the center, on the spacing-scaled index axes) -> input continuous index.
+    // transform_ct_image conjugates the pose by the direction, which gives this same map for any
+    // origin and direction: in = center + S^-1 * pose * S * (out - center)
+    auto to_input = [&](const double* out, double* in) {
+        for (int r = 0; r < 3; ++r) {
+            double q = 0;
+            for (int c = 0; c < 3; ++c) {
+                q += pose[r][c] * spacing[c] * (out[c] - center[c]);
+            }
+            in[r] = center[r] + q / spacing[r];
+        }
+    };
+
+    const double zero[3] = {0, 0, static_cast<double>(As)};
+    to_input(zero, offset);
+    for (int axis = 0; axis < 3; ++axis) {
+        double unit[3] = {0, 0, static_cast<double>(As)};
+        unit[axis] += 1;
+        double in[3];
+        to_input(unit, in);
+        for (int i = 0; i < 3; ++i) {
+            matrix[i][axis] = in[i] - offset[i];
+        }
+    }
+
+    // Axis-aligned parts of the map are exact integers; drop rounding noise so that slices kept by
+    // the pose are read as whole slices (no 0.999... weights truncating integral pixels)
+    auto snap = [](double& value) {
+        const double rounded = std::round(value);
+        if (std::abs(value - rounded) < 1e-9) value = rounded;
+    };
+    for (int i = 0; i < 3; ++i) {
+        snap(offset[i]);
+        for (int axis = 0; axis < 3; ++axis) {
+            snap(matrix[i][axis]);
+        }
+    }
+}
+
+
+template <typename PixelType>
+panorama::TransformedVolume<PixelType>
+panorama::TransformedVolume<PixelType>::slices(const std::pair<short, short>& range) const {
+    const short As = std::max<short>(range.first, 0);
+    const short Ae = std::max<short>(std::min<short>(range.second, static_cast<short>(output_size[2])), As);
+
+    TransformedVolume view(*this);
+    view.first[2] = first[2] + As;
+    view.output_size[2] = Ae - As;
+    for (int i = 0; i < 3; ++i) {
+        view.offset[i] = offset[i] + matrix[i][2] * As;
+    }
+    return view;
+}
+
+
+template <typename PixelType>
+panorama::TransformedVolume<PixelType>
+panorama::TransformedVolume<PixelType>::region(const typename ImageType::RegionType& region) const {
+    TransformedVolume view(*this);
+    long begin[3];
+    for (int j = 0; j < 3; ++j) {
+        const long size = static_cast<long>(output_size[j]);
+        begin[j] = std::min(std::max<long>(region.GetIndex(j), 0), size);
+        const long end = std::min(region.GetIndex(j) + static_cast<long>(region.GetSize(j)), size);
+        view.first[j] = first[j] + begin[j];
+        view.output_size[j] = static_cast<std::size_t>(std::max(end - begin[j], 0L));
+    }
+    for (int i = 0; i < 3; ++i) {
+        view.offset[i] = offset[i] + matrix[i][0] * begin[0] + matrix[i][1] * begin[1] + matrix[i][2] * begin[2];
+    }
+    return view;
+}
+
+
+// The map is affine, so the extremes over the region are at its corners
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::RegionType
+panorama::TransformedVolume<PixelType>::input_region(const typename ImageType::RegionType& region) const {
+    const TransformedVolume view = this->region(region);
+    typename ImageType::RegionType input;
+    for (int j = 0; j < 3; ++j) {
+        if (view.output_size[j] == 0) {
+            return input;
+        }
+    }
+
+    double low[3], high[3];
+    for (int i = 0; i < 3; ++i) {
+        low[i] = std::numeric_limits<double>::max();
+        high[i] = std::numeric_limits<double>::lowest();
+    }
+    for (int corner = 0; corner < 8; ++corner) {
+        double out[3], in[3];
+        for (int j = 0; j < 3; ++j) {
+            out[j] = (corner >> j & 1) ? static_cast<double>(view.output_size[j] - 1) : 0.0;
+        }
+        view.map(out[0], out[1], out[2], in);
+        for (int i = 0; i < 3; ++i) {
+            low[i] = std::min(low[i], in[i]);
+            high[i] = std::max(high[i], in[i]);
+        }
+    }
+
+    // interpolate() reads floor(index) and the voxel after it
+    for (int i = 0; i < 3; ++i) {
+        const long n = static_cast<long>(input_size[i]);
+        const long begin = std::min(std::max(static_cast<long>(std::floor(low[i])), 0L), n);
+        const long end = std::max(std::min(static_cast<long>(std::floor(high[i])) + 2, n), begin);
+        input.SetIndex(i, begin);
+        input.SetSize(i, static_cast<std::size_t>(end - begin));
+    }
+    return input;
+}
+
+
+// TransformedVolume -> itkImage
+template <typename PixelType>
+typename itk::Image<PixelType, 3>::Pointer
+panorama::TransformedVolume<PixelType>::materialize() const {
+    typename ImageType::PointType output_origin;
+    img->TransformIndexToPhysicalPoint(first, output_origin);
+
+    typename ImageType::RegionType region;
+    region.SetSize(output_size);
+
+    auto out = ImageType::New();
+    out->SetRegions(region);
+    out->SetSpacing(img->GetSpacing());
+    out->SetOrigin(output_origin);
+    out->SetDirection(img->GetDirection());
+    allocate_image<PixelType, 3>(out);
+
+    const std::size_t nx = output_size[0];
+    const std::size_t ny = output_size[1];
+    const long nz = static_cast<long>(output_size[2]);
+    PixelType* dst = out->GetBufferPointer();
+
+    #pragma omp parallel for schedule(static)
+    for (long z = 0; z < nz; ++z) {
+        for (std::size_t y = 0; y < ny; ++y) {
+            PixelType* row = dst + (z * ny + y) * nx;
+            for (std::size_t x = 0; x < nx; ++x) {
+                row[x] = sample(static_cast<double>(x), static_cast<double>(y), static_cast<double>(z));
+            }
+        }
+    }
+
+    return out;
+}
+
+
+#define PIXEL_TYPE_VIEW(T) \
+    template class panorama::TransformedVolume<T>;
+PIXEL_TYPE_VIEW(double)
+PIXEL_TYPE_VIEW(short)
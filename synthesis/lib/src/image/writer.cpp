@@ -0,0 +1,121 @@
+#include "../../include/image/writer.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+
+panorama::AsyncWriter::AsyncWriter(const std::size_t &threads, const std::size_t &max_queue, const bool &verbose)
+    : max_queue(max_queue > 0 ? max_queue : 1), verbose(verbose) {
+    const std::size_t n = threads > 0 ? threads : 1;
+    for (std::size_t t = 0; t < n; ++t) {
+        workers.emplace_back(&AsyncWriter::run, this);
+    }
+}
+
+
+panorama::AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    if (written + failed > 0) {
+        std::cout << "[Writer] " << written << " files written";
+        if (failed > 0) {
+            std::cout << ", " << failed << " failed";
+        }
+        std::cout << ", latency mean " << total_latency / static_cast<double>(written + failed)
+                  << " ms / max " << max_latency << " ms, max queue depth " << max_depth << std::endl;
+    }
+}
+
+
+void panorama::AsyncWriter::run() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;     // stopping and drained
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++running;
+        }
+        taken.notify_all();
+
+        const Clock::time_point start = Clock::now();
+        bool ok = true;
+        try {
+            job.write();
+        } catch (const std::exception &e) {
+            std::cerr << "Error writing " << job.path << ": " << e.what() << std::endl;
+            ok = false;
+        }
+        job.write = nullptr;        // release the image before reporting
+        const Clock::time_point end = Clock::now();
+
+        const double latency = std::chrono::duration<double, std::milli>(end - job.submitted).count();
+        const double encode = std::chrono::duration<double, std::milli>(end - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            ok ? ++written : ++failed;
+            total_latency += latency;
+            max_latency = std::max(max_latency, latency);
+            if (verbose) {
+                std::cout << "[Writer] " << job.path << ": " << latency << " ms (write " << encode
+                          << " ms), queue depth " << job.depth << std::endl;
+            }
+        }
+        taken.notify_all();
+    }
+}
+
+
+void panorama::AsyncWriter::submit(const std::string &path, std::function<void()> write) {
+    std::unique_lock<std::mutex> lock(mutex);
+    taken.wait(lock, [this] { return jobs.size() < max_queue; });
+
+    Job job;
+    job.path = path;
+    job.write = std::move(write);
+    job.submitted = Clock::now();
+    job.depth = jobs.size() + 1;
+    max_depth = std::max(max_depth, job.depth);
+    jobs.push_back(std::move(job));
+
+    lock.unlock();
+    queued.notify_one();
+}
+
+
+void panorama::AsyncWriter::write_jpeg(const cv::Mat &img, const std::string &path) {
+    const cv::Mat owned = img;
+    submit(path, [owned, path] {
+        if (!cv::imwrite(path, owned)) {
+            throw std::runtime_error("cv::imwrite failed");
+        }
+    });
+}
+
+
+void panorama::AsyncWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    taken.wait(lock, [this] { return jobs.empty() && running == 0; });
+}
+
+
+std::size_t panorama::AsyncWriter::queue_depth() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+}
@@ -1,6 +1,10 @@
 #include <utils/dataset.hpp>
+#include <image/nifti.hpp>
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
+#include <numeric>
+
 namespace utils {
 
     Dataset::Dataset(const boost::filesystem::path& yaml_path)
@@ -29,5 +33,34 @@ namespace utils {
     boost::filesystem::path Dataset::image_path(std::size_t index) const {
         return paths.at(index);
     }
+
+    void Dataset::probe() {
+        infos.assign(paths.size(), ImageInfo());
+
+        const long count = static_cast<long>(paths.size());
+        #pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < count; ++i) {
+            panorama::NiftiHeader header;
+            if (panorama::read_nifti_header(paths[i].string(), header)) {
+                infos[i].valid = true;
+                infos[i].size = header.size;
+                infos[i].spacing = header.spacing;
+                infos[i].datatype = header.datatype;
+            }
+        }
+    }
+
+    ImageInfo Dataset::image_info(std::size_t index) const {
+        return index < infos.size() ? infos[index] : ImageInfo();
+    }
+
+    std::vector<std::size_t> Dataset::schedule() const {
+        std::vector<std::size_t> order(paths.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](const std::size_t& a, const std::size_t& b) {
+            return image_info(a).voxels() > image_info(b).voxels();
+        });
+        return order;
+    }
 }
 
@@ -6,7 +6,7 @@
 
 #define PARAM_DIM 7
 
-typedef double PixelType;
+typedef short PixelType;
 
 using Image3D = itk::Image<PixelType, 3>;
 using Image2D = itk::Image<PixelType, 2>;
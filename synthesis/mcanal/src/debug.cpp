@@ -6,29 +6,15 @@
 #include <vector>
 #include <algorithm>
 
+#include <image/mat.hpp>
+
 #include "debug.hpp"
 #include "synthesis.hpp"
 
 template <typename PixelType>
 cv::Mat panorama::draw_2d_image(const typename itk::Image<PixelType, 2>::Pointer &img) {
-    // Get ITK image size
-    typename itk::Image<PixelType, 2>::SizeType size_itk = img->GetLargestPossibleRegion().GetSize();
-
-    // Create OpenCV Mat with appropriate type
-    cv::Mat img_cv(size_itk[1], size_itk[0], CV_64F); // Use double for accuracy
-
-    // Check memory allocation
-    if (img_cv.empty()) {
-        throw std::runtime_error("Failed to allocate cv::Mat. Image size might be too large.");
-    }
-
-    // Copy ITK image data to OpenCV matrix
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> imgIter(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++imgIter) {
-            img_cv.at<double>(y, x) = static_cast<double>(imgIter.Get()); // Convert to double
-        }
-    }
+    // View ITK image data as OpenCV matrix (no copy)
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
     // Normalize the image to 8-bit format for visualization
     cv::Mat img_8bit;
@@ -109,15 +95,7 @@ cv::Mat panorama::draw_jaw_box(
     const typename itk::Image<PixelType, 2>::Pointer &mip_image,
     const typename itk::Image<PixelType, 2>::Pointer &mask_image
 ) {
-    typename itk::Image<PixelType, 2>::SizeType size_itk = mip_image->GetLargestPossibleRegion().GetSize();
-    cv::Mat mip_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> mipIter(mip_image, mip_image->GetLargestPossibleRegion());
-    for (int y = 0; y < mip_cv.rows; ++y) {
-        for (int x = 0; x < mip_cv.cols; ++x, ++mipIter) {
-            mip_cv.at<PixelType>(y, x) = mipIter.Get();
-        }
-    }
+    const cv::Mat mip_cv = panorama::as_mat<PixelType>(mip_image);
 
     cv::Mat mip_normalized;
     cv::normalize(mip_cv, mip_normalized, 0, 255, cv::NORM_MINMAX);
@@ -127,13 +105,7 @@ cv::Mat panorama::draw_jaw_box(
     cv::Mat mip_color;
     cv::cvtColor(mip_normalized, mip_color, cv::COLOR_GRAY2BGR);
 
-    cv::Mat mask_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> maskIter(mask_image, mask_image->GetLargestPossibleRegion());
-    for (int y = 0; y < mask_cv.rows; ++y) {
-        for (int x = 0; x < mask_cv.cols; ++x, ++maskIter) {
-            mask_cv.at<PixelType>(y, x) = maskIter.Get();
-        }
-    }
+    const cv::Mat mask_cv = panorama::as_mat<PixelType>(mask_image);
 
     cv::Mat mask_normalized;
     cv::normalize(mask_cv, mask_normalized, 0, 255, cv::NORM_MINMAX);
@@ -193,26 +165,9 @@ cv::Mat panorama::draw_sagittal_plane(
     const typename itk::Image<PixelType, 2>::Pointer &mip_image,  
     const typename itk::Image<PixelType, 2>::Pointer &mask_image 
 ) {
-    // Convert ITK images to OpenCV format
-    typename itk::Image<PixelType, 2>::SizeType size_itk = mip_image->GetLargestPossibleRegion().GetSize();
-    cv::Mat mip_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-    cv::Mat mask_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    // Copy MIP image to OpenCV matrix
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> mipIter(mip_image, mip_image->GetLargestPossibleRegion());
-    for (int y = 0; y < mip_cv.rows; ++y) {
-        for (int x = 0; x < mip_cv.cols; ++x, ++mipIter) {
-            mip_cv.at<PixelType>(y, x) = mipIter.Get();
-        }
-    }
-
-    // Copy Mask image to OpenCV matrix
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> maskIter(mask_image, mask_image->GetLargestPossibleRegion());
-    for (int y = 0; y < mask_cv.rows; ++y) {
-        for (int x = 0; x < mask_cv.cols; ++x, ++maskIter) {
-            mask_cv.at<PixelType>(y, x) = maskIter.Get();
-        }
-    }
+    // View ITK images as OpenCV matrices (no copy)
+    const cv::Mat mip_cv = panorama::as_mat<PixelType>(mip_image);
+    const cv::Mat mask_cv = panorama::as_mat<PixelType>(mask_image);
 
     // Normalize MIP image to [0, 255]
     double minVal, maxVal;
@@ -272,17 +227,8 @@ cv::Mat panorama::draw_coronal_plane(
     const typename itk::Image<PixelType, 2>::Pointer &img,
     const typename std::pair<short, short> &slice_range
 ) {
-    // Convert ITK image size to OpenCV format
-    typename itk::Image<PixelType, 2>::SizeType size_itk = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    // Copy ITK image data to OpenCV matrix
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> imgIter(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++imgIter) {
-            img_cv.at<PixelType>(y, x) = imgIter.Get();
-        }
-    }
+    // View ITK image data as OpenCV matrix (no copy)
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
     // Normalize the image to 8-bit format for visualization
     cv::Mat img_8bit;
@@ -317,17 +263,8 @@ cv::Mat parida::draw_axial_plane(
     const typename itk::Image<PixelType, 2>::Pointer &img,
     const BoxParam &box_params
 ) {
-    // Convert ITK image size to OpenCV format
-    typename itk::Image<PixelType, 2>::SizeType size_itk = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size_itk[1], size_itk[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    // Copy ITK image data to OpenCV matrix
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> imgIter(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++imgIter) {
-            img_cv.at<PixelType>(y, x) = imgIter.Get();
-        }
-    }
+    // View ITK image data as OpenCV matrix (no copy)
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
     // Normalize the image to 8-bit format for visualization
     cv::Mat img_8bit;
@@ -9,7 +9,10 @@
 #include <utils/dataset.hpp>
 #include <image/core.hpp>
 #include <image/io.hpp>
+#include <image/writer.hpp>
+#include <image/nifti.hpp>
 #include <image/mip.hpp>
+#include <image/view.hpp>
 #include <image/mask.hpp>
 
 #include <hist/core.hpp>
@@ -29,6 +32,10 @@ int main() {
     const auto DST_ROOT = HOME / "workspace" / "kobe" / "synthesis" / "_out" / "mcanal";
     
     const utils::Dataset dataset(SRC_ROOT / "data.yml");
+    // Artifacts are encoded and written off the compute threads
+    const std::size_t WRITER_THREADS = 2;
+    panorama::AsyncWriter writer(WRITER_THREADS);
+
     #pragma omp parallel for 
     //for (size_t i = 0; i < dataset.size(); i++) {
     for (size_t i = 0; i < 1; i++) {
@@ -42,11 +49,15 @@ int main() {
         std::cout << input_number << std::endl;
         std::string output_filename = "vanitas vanitatum, et omnia vanitas" + input_number;
         boost::filesystem::path output_path = DST_ROOT / output_filename;
+        // .nii.gz inputs are decompressed once into the cache so later runs can map them
+        const std::string ct_path = panorama::cache_nifti(ct_image_path.string(), (DST_ROOT / "Cache").string());
         Image3D::Pointer img_ct = panorama::read_image<PixelType>(
-            ct_image_path.string()
+            ct_path
         );
         
-        img_ct = panorama::window_ct_image<PixelType>(img_ct);
+        panorama::window_ct_image_inplace<PixelType>(img_ct);
+        // Isotropic voxels (slices resampled to the in-plane spacing) before any slice range is derived
+        img_ct = panorama::resampling_ct_image<PixelType>(img_ct);
         Image2D::Pointer coronal_mip = panorama::compute_coronal_mip_image<PixelType>(img_ct);
 
         /*
@@ -79,13 +90,14 @@ int main() {
         double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<PixelType>(axial_mask);
         double correction_angle = parida::calc_sagittal_correction_angle(sagittal_tilt_angle);
         // Rotate around the superior-inferior axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'z', correction_angle);
-        roi_ct = panorama::rotate_ct_image<PixelType>(roi_ct, 'z', correction_angle);
+        // (rotations are accumulated in pose; MIPs interpolate through it, only the sampling slices are resampled)
+        itk::Matrix<double, 3, 3> pose = panorama::calc_rotation_matrix('z', correction_angle);
+        const panorama::TransformedVolume<PixelType> posed_ct(img_ct, pose);
   
         /*
          * Jaw area detection using axial MIP from ROI slices
          */
-        axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
+        axial_mip = panorama::compute_axial_mip_image<PixelType>(posed_ct.slices(roi_range));
         axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
         axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
         BoxParam jaw_area_param = parida::calc_jaw_area_param<PixelType>(axial_mask);
@@ -93,22 +105,22 @@ int main() {
         /*
          * Tilt correction (regarding axial reference plane)
          */
-        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
+        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(posed_ct);
         Image2D::Pointer sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
         sagittal_mask = panorama::process_tooth_mask<PixelType>(sagittal_mask);
         double axial_tilt_angle = poemi::calc_axial_tilt_angle<PixelType>(sagittal_mask);
         correction_angle = poemi::calc_axial_correction_angle(axial_tilt_angle);
 
         // Rotate around the left-right axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'x', correction_angle);
-        sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
+        pose = pose * panorama::calc_rotation_matrix('x', correction_angle);
 
         /*
          * Sampling CT slice
          */
         Range sampling_slice_range = poemi::calc_sampling_slice_range(horizontal_hist);
-        img_ct = panorama::extract_slices<PixelType>(img_ct, sampling_slice_range);
+        // Single resampling of the corrected pose, cropped to the sampling slices
+        // (three shears when only one tilt was corrected)
+        img_ct = panorama::transform_ct_image<PixelType>(img_ct, pose, sampling_slice_range, panorama::RotationEngine::Shear);
 
         /*
          * Synthesis panoramic X-ray Image
@@ -116,13 +128,13 @@ int main() {
         Image2D::Pointer img_panorama = parida::compute_panoramic_image<PixelType>(img_ct, jaw_area_param);     
         output_filename = input_number + ".nii.gz";
         output_path = DST_ROOT / "Panorama" / output_filename;
-        panorama::write_image<PixelType, 2>(img_panorama, output_path.string());
+        writer.write_image<PixelType, 2>(img_panorama, output_path.string());
         // debug panorama
         boost::filesystem::create_directories(DST_ROOT / "Debug Panorama");
         cv::Mat img_debug_panorama = panorama::draw_2d_image<PixelType>(img_panorama);
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Debug Panorama" / output_filename;
-        cv::imwrite(output_path.string(), img_debug_panorama);
+        writer.write_jpeg(img_debug_panorama, output_path.string());
         
     }   
 
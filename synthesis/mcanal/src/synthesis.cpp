@@ -5,20 +5,17 @@
 #include <algorithm>
 
 #include "synthesis.hpp"
+#include "image/mat.hpp"
 //#include "image/mip.hpp"
 
 // Calculate Jaw Box Parameter
 template <typename PixelType>
 BoxParam parida::calc_jaw_area_param(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), const_cast<PixelType*>(img->GetBufferPointer()));
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
+    // Mask pixels are 0 or positive integers for every PixelType: saturate foreground to 255
     cv::Mat img_8bit;
-    if (std::is_integral<PixelType>::value) {
-        img_cv.convertTo(img_8bit, CV_8UC1);
-    } else {
-        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
-    }
+    img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
 
     cv::Mat binary;
     cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
@@ -4,9 +4,11 @@
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 
+#include <image/view.hpp>
+
 #define PARAM_DIM 7
 
-typedef double PixelType;
+typedef short PixelType;
 
 using Image3D = itk::Image<PixelType, 3>;
 using Image2D = itk::Image<PixelType, 2>;
@@ -20,7 +22,18 @@ struct BoxParam {
     float angle;          // 回転角度（度）
 };
 
+// Per-column ray samples, stored as flattened in-plane offsets (y * width + x)
+struct RayTable {
+    std::vector<std::size_t> column_begin;    // ray i spans offsets[column_begin[i] .. column_begin[i + 1])
+    std::vector<std::ptrdiff_t> offsets;
+};
+
 namespace parida {
+    // Arch angles and ray length of the synthesis (they also bound the voxels it reads)
+    constexpr float START_ANGLE = 190.0f;
+    constexpr float END_ANGLE = 350.0f;
+    constexpr int RAY_LENGTH = 200;
+
     template <typename PixelType>
     BoxParam calc_jaw_area_param(const typename itk::Image<PixelType, 2>::Pointer&);
 
@@ -31,10 +44,40 @@ namespace parida {
         double cx, double cy, double normalSlope, int length
     );
 
+    // corner: in-plane index of the image's first voxel in the slice the box was detected on
+    // (offsets are relative to it, pixels outside the image are dropped)
+    RayTable build_ray_table(
+        const BoxParam&,
+        const std::vector<double>&,                     // サンプリング位置（角度の累積）
+        const float&,                                   // 開始角度
+        const int&,                                     // 光線長さ
+        const std::size_t&,                             // 画像幅
+        const std::size_t&,                             // 画像高さ
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
+    // In-plane rectangle of a width x height slice holding every ray sample of the synthesis:
+    // sampling slices cropped to it give the same panorama (pass its top-left as corner)
+    cv::Rect calc_sampling_rect(const BoxParam&, const std::size_t&, const std::size_t&);
+
+    // clamp: window samples to [HU_MIN, HU_MAX] on read (for volumes that were not windowed)
+    // corner: in-plane index of the volume's first voxel (for volumes cropped to calc_sampling_rect)
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer compute_panoramic_image(
         const typename itk::Image<PixelType, 3>::Pointer&, 
-        const BoxParam&
+        const BoxParam&,
+        const bool& clamp = false,
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
+    // Same synthesis read through a posed volume: only the voxels on the rays are interpolated
+    // corner: in-plane index of the view's first voxel in the frame of the box (for views of cropped volumes)
+    template <typename PixelType>
+    typename itk::Image<PixelType, 2>::Pointer compute_panoramic_image(
+        const panorama::TransformedVolume<PixelType>&,
+        const BoxParam&,
+        const bool& clamp = false,
+        const cv::Point& corner = cv::Point(0, 0)
     );
 }
 
@@ -7,10 +7,16 @@
 #include <boost/filesystem.hpp>
 
 #include <utils/dataset.hpp>
+#include <utils/prefetch.hpp>
 #include <image/core.hpp>
 #include <image/io.hpp>
+#include <image/writer.hpp>
+#include <image/nifti.hpp>
+#include <image/cache.hpp>
+#include <image/view.hpp>
 #include <image/mip.hpp>
 #include <image/mask.hpp>
+#include <image/stream.hpp>
 
 #include <hist/core.hpp>
 
@@ -18,6 +24,231 @@
 #include "param.hpp"
 #include "debug.hpp"
 
+/*
+ * Read-heavy first pass of one case (runs on the prefetch I/O threads):
+ * cache the input, stream the coronal MIP, derive thresholds and slice ranges,
+ * read the windowed z-slab the rest of the pipeline needs (resampled to isotropic voxels), find its tilt correction
+ * and jaw area, and crop it to the head and the voxels the synthesis reads.
+ * A rerun resumes from the deepest cached stage instead: the tilt-corrected sampling
+ * slices (only the synthesis is left) or the windowed slab (the first pass is skipped).
+ */
+struct LoadedCase {
+    Image2D::Pointer coronal_mip;       // full first pass only (debug images)
+    panorama::MaskImage::Pointer axial_mask;    // full first pass only (debug images)
+    Image3D::Pointer img_ct;            // slab_range of the volume, windowed, isotropic and cropped; nullptr if loading failed
+    bool corrected = false;             // img_ct is already the tilt-corrected sampling slices
+    BoxParam jaw_area_param;            // in-plane indices of the uncropped slab
+    cv::Point corner;                   // in-plane index of img_ct's first voxel in the uncropped slab
+    double correction_angle;            // not corrected: sagittal tilt correction (degrees, about z)
+    cv::Rect sampling_rect;             // not corrected: parida::calc_sampling_rect of the jaw area, uncropped slab
+    std::string corrected_key;          // volume cache entry of the corrected stage
+    PixelType bone_threshold;
+    PixelType tooth_threshold;
+    Hist horizontal_hist;
+    Hist horizontal_curve;
+    Range roi_range;
+    Range sampling_slice_range;
+    Range slab_range;
+    Range sampling_slices;              // not corrected: sampling_slice_range in slices of img_ct
+};
+
+LoadedCase load_case(
+    const boost::filesystem::path& ct_image_path,
+    const boost::filesystem::path& cache_dir,
+    const panorama::VolumeCache& volume_cache
+) {
+    LoadedCase loaded;
+
+    // Head region of the windowed slab (see panorama::calc_head_region)
+    const PixelType HEAD_THRESHOLD = panorama::HU_AIR;
+    const std::size_t HEAD_STEP = 4;
+    const std::size_t HEAD_MARGIN = 8;
+
+    /*
+     * Cached stages, keyed by the input file and every parameter a stage depends on
+     * (bump CACHE_VERSION when a stage computes something different for the same parameters)
+     */
+    const std::string CACHE_VERSION = "5";
+    const std::string fingerprint = panorama::fingerprint_file(ct_image_path.string());
+    const std::string params = "v" + CACHE_VERSION +
+        ",hu=" + std::to_string(panorama::HU_MIN) + ":" + std::to_string(panorama::HU_MAX) +
+        ",head=" + std::to_string(HEAD_THRESHOLD) + "/" + std::to_string(HEAD_STEP) + "/" + std::to_string(HEAD_MARGIN) +
+        ",rays=" + std::to_string(parida::RAY_LENGTH) +
+        "@" + std::to_string(parida::START_ANGLE) + ":" + std::to_string(parida::END_ANGLE);
+    const std::string windowed_key = volume_cache.key(fingerprint, "windowed", params);
+    loaded.corrected_key = volume_cache.key(fingerprint, "corrected", params);
+
+    std::vector<double> values;
+    if ((loaded.img_ct = volume_cache.load<PixelType>(loaded.corrected_key, values)) && values.size() == 7) {
+        loaded.corrected = true;
+        loaded.jaw_area_param.center = cv::Point2f(values[0], values[1]);
+        loaded.jaw_area_param.size = cv::Size2f(values[2], values[3]);
+        loaded.jaw_area_param.angle = static_cast<float>(values[4]);
+        loaded.corner = cv::Point(static_cast<int>(values[5]), static_cast<int>(values[6]));
+        return loaded;
+    }
+    if ((loaded.img_ct = volume_cache.load<PixelType>(windowed_key, values)) && values.size() == 22) {
+        loaded.bone_threshold = static_cast<PixelType>(values[0]);
+        loaded.tooth_threshold = static_cast<PixelType>(values[1]);
+        loaded.roi_range = Range(values[2], values[3]);
+        loaded.sampling_slice_range = Range(values[4], values[5]);
+        loaded.slab_range = Range(values[6], values[7]);
+        loaded.correction_angle = values[8];
+        loaded.jaw_area_param.center = cv::Point2f(values[9], values[10]);
+        loaded.jaw_area_param.size = cv::Size2f(values[11], values[12]);
+        loaded.jaw_area_param.angle = static_cast<float>(values[13]);
+        loaded.corner = cv::Point(static_cast<int>(values[14]), static_cast<int>(values[15]));
+        loaded.sampling_rect = cv::Rect(static_cast<int>(values[16]), static_cast<int>(values[17]),
+                                        static_cast<int>(values[18]), static_cast<int>(values[19]));
+        loaded.sampling_slices = Range(values[20], values[21]);
+        return loaded;
+    }
+    loaded.img_ct = nullptr;
+
+    // .nii.gz inputs are decompressed once into the cache so later runs can map them
+    const std::string ct_path = panorama::cache_nifti(ct_image_path.string(), cache_dir.string());
+
+    /*
+     * First pass: coronal MIP and volume max in one sweep per slab (windowed on read),
+     * the full volume is never decoded
+     */
+    const panorama::OrthogonalMIPs<PixelType> first_pass = panorama::compute_orthogonal_mips<PixelType>(ct_path);
+    loaded.coronal_mip = first_pass.coronal;
+    if (!loaded.coronal_mip) {
+        return loaded;
+    }
+
+    /*
+     * Calculate threshold using coronal MIP 
+     */
+    Hist coronal_intensity_hist = panorama::compute_intensity_histogram<PixelType>(loaded.coronal_mip);       
+    Hist coronal_intensity_curve = panorama::compute_intensity_curve(coronal_intensity_hist);
+    loaded.bone_threshold = panorama::calc_bone_threshold<PixelType>(coronal_intensity_curve);
+    loaded.tooth_threshold = panorama::calc_tooth_threshold<PixelType>(coronal_intensity_curve);
+    if (first_pass.max_value <= loaded.tooth_threshold) {
+        std::cout << "No voxel above the tooth threshold, skip: " << ct_image_path << std::endl;
+        return loaded;
+    }
+
+    /*
+     * Calculate ROI range using horizontal histogram
+     */
+    panorama::BitMask coronal_mask = panorama::compute_bit_mask<PixelType>(loaded.coronal_mip, loaded.tooth_threshold);
+    loaded.horizontal_hist = panorama::compute_horizontal_histogram(coronal_mask);
+    loaded.horizontal_curve = panorama::compute_horizontal_curve(loaded.horizontal_hist);
+    loaded.roi_range = panorama::calc_roi_range(loaded.horizontal_curve);
+
+    /*
+     * Read only the slab covering the ROI and the sampling slices
+     */
+    loaded.sampling_slice_range = poemi::calc_sampling_slice_range(loaded.horizontal_hist);
+    loaded.slab_range = Range(
+        std::max<short>(std::min(loaded.roi_range.first, loaded.sampling_slice_range.first), 0),
+        std::max(loaded.roi_range.second, loaded.sampling_slice_range.second)
+    );
+    loaded.img_ct = panorama::read_image_region<PixelType>(ct_path, loaded.slab_range);
+    if (loaded.img_ct) {
+        panorama::window_ct_image_inplace<PixelType>(loaded.img_ct);
+
+        /*
+         * Isotropic voxels (slices resampled to the in-plane spacing), so every input reaches the
+         * tilt corrections and the synthesis on the same kind of grid; the in-plane indices are kept
+         */
+        const double thickness = loaded.img_ct->GetSpacing()[2];
+        loaded.img_ct = panorama::resampling_ct_image<PixelType>(loaded.img_ct);
+        const double scale = loaded.img_ct->GetSpacing()[2] / thickness;
+        const short slices = static_cast<short>(loaded.img_ct->GetLargestPossibleRegion().GetSize(2));
+
+        // Slice ranges relative to the slab, on the resampled slices (slice o samples the slab at o * scale)
+        auto to_slab = [&](const Range& range) {
+            auto slice = [&](const short& z) {
+                const double o = std::ceil((z - loaded.slab_range.first) / scale - 1e-6);
+                return static_cast<short>(std::min(std::max(o, 0.0), static_cast<double>(slices)));
+            };
+            return Range(slice(range.first), slice(range.second));
+        };
+        const Range roi_slices = to_slab(loaded.roi_range);
+        const Range sampling_slices = to_slab(loaded.sampling_slice_range);
+        loaded.sampling_slices = sampling_slices;
+
+        /*
+         * Tilt corrction (regarding sagittal reference plane) using axial MIP from ROI slices
+         */
+        Image2D::Pointer axial_mip = panorama::compute_axial_mip_image<PixelType>(panorama::extract_slices<PixelType>(loaded.img_ct, roi_slices));
+        loaded.axial_mask = panorama::compute_binary_mask<PixelType>(axial_mip, loaded.bone_threshold);
+        loaded.axial_mask = panorama::process_jaw_mask<unsigned char>(loaded.axial_mask);
+        double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<unsigned char>(loaded.axial_mask);
+        loaded.correction_angle = parida::calc_sagittal_correction_angle(sagittal_tilt_angle);
+        // Rotate around the superior-inferior axis (interpolated through the pose, never resampled)
+        const panorama::TransformedVolume<PixelType> posed_ct(loaded.img_ct, panorama::calc_rotation_matrix('z', loaded.correction_angle));
+
+        /*
+         * Jaw area detection using axial MIP from ROI slices
+         */
+        axial_mip = panorama::compute_axial_mip_image<PixelType>(posed_ct.slices(roi_slices));
+        panorama::MaskImage::Pointer jaw_mask = panorama::compute_binary_mask<PixelType>(axial_mip, loaded.bone_threshold);
+        jaw_mask = panorama::process_jaw_mask<unsigned char>(jaw_mask);
+        loaded.jaw_area_param = parida::calc_jaw_area_param<unsigned char>(jaw_mask);
+
+        /*
+         * Crop the slab in-plane to the head (everything above air, the table included), the columns
+         * the rays cover and the voxels they interpolate, with the same margin on both sides of each axis:
+         * the rotation center stays on the same voxel, so the rays read the values of the uncropped slab
+         * (up to the rounding of the interpolation weights; the slice ranges stay valid; the origin keeps physical coordinates)
+         */
+        const Image3D::SizeType slab_size = loaded.img_ct->GetLargestPossibleRegion().GetSize();
+        const panorama::TransformedVolume<PixelType> sampling_ct = posed_ct.slices(sampling_slices);
+        loaded.sampling_rect = parida::calc_sampling_rect(loaded.jaw_area_param, slab_size[0], slab_size[1]);
+        Image3D::RegionType sampling_region;
+        sampling_region.SetIndex({loaded.sampling_rect.x, loaded.sampling_rect.y, 0});
+        sampling_region.SetSize({static_cast<std::size_t>(loaded.sampling_rect.width), static_cast<std::size_t>(loaded.sampling_rect.height), sampling_ct.size()[2]});
+
+        long low[2] = {static_cast<long>(slab_size[0]), static_cast<long>(slab_size[1])};
+        long high[2] = {0, 0};
+        for (const Image3D::RegionType& region : {
+                 panorama::calc_head_region<PixelType>(loaded.img_ct, HEAD_THRESHOLD, HEAD_STEP, HEAD_MARGIN),
+                 sampling_region,
+                 sampling_ct.input_region(sampling_region)}) {
+            if (region.GetNumberOfPixels() == 0) {
+                continue;
+            }
+            for (unsigned int i = 0; i < 2; ++i) {
+                low[i] = std::min<long>(low[i], region.GetIndex(i));
+                high[i] = std::max<long>(high[i], region.GetIndex(i) + static_cast<long>(region.GetSize(i)));
+            }
+        }
+        Image3D::RegionType crop_region;
+        crop_region.SetIndex({low[0], low[1], 0});
+        crop_region.SetSize({static_cast<std::size_t>(high[0] - low[0]), static_cast<std::size_t>(high[1] - low[1]), slab_size[2]});
+        crop_region = panorama::calc_centered_region(crop_region, slab_size);
+
+        const std::size_t slab_voxels = loaded.img_ct->GetLargestPossibleRegion().GetNumberOfPixels();
+        loaded.img_ct = panorama::crop_image<PixelType>(loaded.img_ct, crop_region);
+        loaded.corner = cv::Point(static_cast<int>(crop_region.GetIndex(0)), static_cast<int>(crop_region.GetIndex(1)));
+        const std::size_t head_voxels = loaded.img_ct->GetLargestPossibleRegion().GetNumberOfPixels();
+        std::cout << ct_image_path.filename().string() + ": head crop keeps " +
+                     std::to_string(head_voxels) + " of " + std::to_string(slab_voxels) + " voxels (" +
+                     std::to_string(static_cast<int>(std::round(100.0 * head_voxels / slab_voxels))) + "%)\n" << std::flush;
+
+        volume_cache.store<PixelType>(windowed_key, loaded.img_ct, {
+            static_cast<double>(loaded.bone_threshold), static_cast<double>(loaded.tooth_threshold),
+            static_cast<double>(loaded.roi_range.first), static_cast<double>(loaded.roi_range.second),
+            static_cast<double>(loaded.sampling_slice_range.first), static_cast<double>(loaded.sampling_slice_range.second),
+            static_cast<double>(loaded.slab_range.first), static_cast<double>(loaded.slab_range.second),
+            loaded.correction_angle,
+            loaded.jaw_area_param.center.x, loaded.jaw_area_param.center.y,
+            loaded.jaw_area_param.size.width, loaded.jaw_area_param.size.height, loaded.jaw_area_param.angle,
+            static_cast<double>(loaded.corner.x), static_cast<double>(loaded.corner.y),
+            static_cast<double>(loaded.sampling_rect.x), static_cast<double>(loaded.sampling_rect.y),
+            static_cast<double>(loaded.sampling_rect.width), static_cast<double>(loaded.sampling_rect.height),
+            static_cast<double>(loaded.sampling_slices.first), static_cast<double>(loaded.sampling_slices.second)
+        });
+    }
+
+    return loaded;
+}
+
+
 /**
  * Main function
  *
@@ -28,13 +259,41 @@ int main() {
     const auto SRC_ROOT = HOME / "workspace" / "kobe" / "data" / "mronj" / "ct";
     const auto DST_ROOT = HOME / "workspace" / "kobe" / "synthesis" / "_out" / "tronj";
     std::cout << "a" << std::endl;
-    const utils::Dataset dataset(SRC_ROOT / "data.yml");
+    utils::Dataset dataset(SRC_ROOT / "data.yml");
 
     //const utils::Dataset dataset(SRC_ROOT / "test.yml");
 
-    #pragma omp parallel for 
-    for (size_t i = 0; i < dataset.size(); i++) {
-        boost::filesystem::path ct_image_path = dataset.image_path(i);
+    // Largest volumes first, so the batch does not end on one long case
+    dataset.probe();
+    const std::vector<std::size_t> order = dataset.schedule();
+
+    // Intermediate volumes of earlier runs
+    const panorama::VolumeCache volume_cache((DST_ROOT / "Cache" / "Volumes").string());
+
+    // Prefetch: I/O threads run the read-heavy first pass of upcoming cases
+    const std::size_t IO_THREADS = 2;
+    const std::size_t PREFETCH_DEPTH = 4;                   // cases loaded ahead of the compute threads
+    const std::size_t PREFETCH_MEMORY = std::size_t(4) << 30;  // bytes of loaded slabs waiting (soft cap)
+
+    utils::Prefetcher<LoadedCase> prefetcher(
+        order.size(),
+        [&](const std::size_t& k) { return load_case(dataset.image_path(order[k]), DST_ROOT / "Cache", volume_cache); },
+        [](const LoadedCase& loaded) {
+            return loaded.img_ct ? loaded.img_ct->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(PixelType) : 0;
+        },
+        IO_THREADS, PREFETCH_DEPTH, PREFETCH_MEMORY
+    );
+
+    // Artifacts are encoded and written off the compute threads
+    const std::size_t WRITER_THREADS = 2;
+    panorama::AsyncWriter writer(WRITER_THREADS);
+
+    #pragma omp parallel
+    {
+    std::size_t k;
+    LoadedCase loaded;
+    while (prefetcher.pop(k, loaded)) {
+        boost::filesystem::path ct_image_path = dataset.image_path(order[k]);
         std::string input_number;
         std::smatch match;
         const std::regex number_regex(R"((\d{3})\D*$)");
@@ -44,161 +303,146 @@ int main() {
         std::cout << input_number << std::endl;
         std::string output_filename = "vanitas vanitatum, et omnia vanitas" + input_number;
         boost::filesystem::path output_path = DST_ROOT / output_filename;
-        Image3D::Pointer img_ct = panorama::read_image<PixelType>(
-            ct_image_path.string()
-        );
+        if (!loaded.img_ct) {
+            continue;
+        }
 
-        auto region = img_ct->GetLargestPossibleRegion();
-        auto size = region.GetSize();
-        auto spacing = img_ct->GetSpacing();
+        Image3D::Pointer img_ct = loaded.img_ct;
+        BoxParam jaw_area_param = loaded.jaw_area_param;
+        Image2D::Pointer img_panorama;
+        if (!loaded.corrected) {
+            Image2D::Pointer coronal_mip = loaded.coronal_mip;
+            PixelType bone_threshold = loaded.bone_threshold;
+            PixelType tooth_threshold = loaded.tooth_threshold;
+            Hist horizontal_hist = loaded.horizontal_hist;
+            Hist horizontal_curve = loaded.horizontal_curve;
+            Range roi_range = loaded.roi_range;
 
-        std::cout << "Slices: " << size[2] << ", Thickness: " << spacing[2] << " mm" << std::endl;
+            std::cout << "Slices: " << img_ct->GetLargestPossibleRegion().GetSize(2)
+                      << ", Thickness: " << img_ct->GetSpacing()[2] << " mm" << std::endl;
 
-        img_ct = panorama::window_ct_image<PixelType>(img_ct);
-        Image2D::Pointer coronal_mip = panorama::compute_coronal_mip_image<PixelType>(img_ct);
+            // std::cout << "[INFO] Bone threshold: " << bone_threshold << std::endl;  
+            // std::cout << "[INFO] Tooth threshold: " << tooth_threshold << std::endl;
+            // boost::filesystem::create_directories(DST_ROOT / "Intensity Histogram");
+            // short draw_tooth_threshold = 255 * (tooth_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
+            // short draw_bone_threshold = 255 * (bone_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
+            // cv::Mat img_intensity_hist = panorama::draw_histogram(coronal_intensity_hist, coronal_intensity_curve, 
+            //                                                     draw_tooth_threshold, draw_bone_threshold);
+            // output_filename = input_number + ".jpg";
+            // output_path = DST_ROOT / "Intensity Histogram" / output_filename;
+            // cv::imwrite(output_path.string(), img_intensity_hist);
 
-        /*
-         * Calculate threshold using coronal MIP 
-         */
-        Hist coronal_intensity_hist = panorama::compute_intensity_histogram<PixelType>(coronal_mip);       
-        Hist coronal_intensity_curve = panorama::compute_intensity_curve(coronal_intensity_hist);
-        PixelType bone_threshold = panorama::calc_bone_threshold<PixelType>(coronal_intensity_curve);
-        PixelType tooth_threshold = panorama::calc_tooth_threshold<PixelType>(coronal_intensity_curve);
-
-        // std::cout << "[INFO] Bone threshold: " << bone_threshold << std::endl;  
-        // std::cout << "[INFO] Tooth threshold: " << tooth_threshold << std::endl;
-        // boost::filesystem::create_directories(DST_ROOT / "Intensity Histogram");
-        // short draw_tooth_threshold = 255 * (tooth_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
-        // short draw_bone_threshold = 255 * (bone_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
-        // cv::Mat img_intensity_hist = panorama::draw_histogram(coronal_intensity_hist, coronal_intensity_curve, 
-        //                                                     draw_tooth_threshold, draw_bone_threshold);
-        // output_filename = input_number + ".jpg";
-        // output_path = DST_ROOT / "Intensity Histogram" / output_filename;
-        // cv::imwrite(output_path.string(), img_intensity_hist);
+            // Debug images of the first pass (not redone when resuming from the windowed slab)
+            if (coronal_mip) {
+                panorama::MaskImage::Pointer coronal_mask = panorama::compute_binary_mask<PixelType>(coronal_mip, tooth_threshold);
 
-        /*
-         * Calculate ROI range using horizontal histogram
-         */
-        Image2D::Pointer coronal_mask = panorama::compute_mask_image(coronal_mip, tooth_threshold);
-        Hist horizontal_hist = panorama::compute_horizontal_histogram<PixelType>(coronal_mask, tooth_threshold);
-        Hist horizontal_curve = panorama::compute_horizontal_curve(horizontal_hist);
-        Range roi_range = panorama::calc_roi_range(horizontal_curve);
-
-        boost::filesystem::create_directories(DST_ROOT / "Horizontal Histogram");
-        cv::Mat img_horizontal_hist = panorama::draw_histogram(horizontal_hist, horizontal_curve, 
-                                                             roi_range.first, roi_range.second);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "Horizontal Histogram" / output_filename;
-        cv::imwrite(output_path.string(), img_horizontal_hist);
+                boost::filesystem::create_directories(DST_ROOT / "Horizontal Histogram");
+                cv::Mat img_horizontal_hist = panorama::draw_histogram(horizontal_hist, horizontal_curve, 
+                                                                     roi_range.first, roi_range.second);
+                output_filename = input_number + ".jpg";
+                output_path = DST_ROOT / "Horizontal Histogram" / output_filename;
+                writer.write_jpeg(img_horizontal_hist, output_path.string());
         
-        boost::filesystem::create_directories(DST_ROOT / "Coronal MIP");
-        cv::Mat img_coronal_mip = panorama::draw_2d_image<PixelType>(coronal_mip);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "Coronal MIP" / output_filename;
-        cv::imwrite(output_path.string(), img_coronal_mip);
+                boost::filesystem::create_directories(DST_ROOT / "Coronal MIP");
+                cv::Mat img_coronal_mip = panorama::draw_2d_image<PixelType>(coronal_mip);
+                output_filename = input_number + ".jpg";
+                output_path = DST_ROOT / "Coronal MIP" / output_filename;
+                writer.write_jpeg(img_coronal_mip, output_path.string());
 
-        boost::filesystem::create_directories(DST_ROOT / "ROI Range");
-        cv::Mat img_roi_range = panorama::draw_coronal_plane<PixelType>(coronal_mask, roi_range);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "ROI Range" / output_filename;
-        cv::imwrite(output_path.string(), img_roi_range);
+                boost::filesystem::create_directories(DST_ROOT / "ROI Range");
+                cv::Mat img_roi_range = panorama::draw_coronal_plane<unsigned char>(coronal_mask, roi_range);
+                output_filename = input_number + ".jpg";
+                output_path = DST_ROOT / "ROI Range" / output_filename;
+                writer.write_jpeg(img_roi_range, output_path.string());
 
-        Image2D::Pointer coronal_bone = panorama::compute_mask_image<PixelType>(coronal_mip, bone_threshold);
-        coronal_bone = panorama::process_jaw_mask<PixelType>(coronal_bone);
-        boost::filesystem::create_directories(DST_ROOT / "Coronal Bone Mask");
-        cv::Mat img_coronal_bone = panorama::draw_2d_image<PixelType>(coronal_bone);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "Coronal Bone Mask" / output_filename;
-        cv::imwrite(output_path.string(), img_coronal_bone);
-        /*
-         * Extract ROI slices
-         */
-        Image3D::Pointer roi_ct = panorama::extract_slices<PixelType>(img_ct, roi_range);
-        Image2D::Pointer axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
-
-        // Hist axial_intensity_hist = panorama::compute_intensity_histogram<PixelType>(axial_mip);
-        // Hist axial_intensity_curve = panorama::compute_intensity_curve(axial_intensity_hist);
-        // boost::filesystem::create_directories(DST_ROOT / "Axial Intensity Histogram");
-        // tooth_threshold = panorama::calc_tooth_threshold<PixelType>(axial_intensity_curve);
-        // bone_threshold = panorama::calc_bone_threshold<PixelType>(axial_intensity_curve);
-        // std::cout << "[INFO] Axial Bone threshold: " << bone_threshold << std::endl;
-        // std::cout << "[INFO] Axial Tooth threshold: " << tooth_threshold << std::endl;
-        // draw_tooth_threshold = 255 * (tooth_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
-        // draw_bone_threshold = 255 * (bone_threshold - panorama::HU_MIN) / (panorama::HU_MAX - panorama::HU_MIN);
-        // cv::Mat img_axial_intensity_hist = parida::draw_histogram(axial_intensity_hist, axial_intensity_curve, 
-        //                                                            draw_tooth_threshold, draw_bone_threshold);
-        // output_filename = input_number + ".jpg";
-        // output_path = DST_ROOT / "Axial Intensity Histogram" / output_filename;
-        // cv::imwrite(output_path.string(), img_axial_intensity_hist);
-
-        Image2D::Pointer axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
-        axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
-
-        boost::filesystem::create_directories(DST_ROOT / "Axial Mask");
-        cv::Mat img_axial_mask = panorama::draw_2d_image<PixelType>(axial_mask);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "Axial Mask" / output_filename;
-        cv::imwrite(output_path.string(), img_axial_mask);
+                panorama::MaskImage::Pointer coronal_bone = panorama::compute_binary_mask<PixelType>(coronal_mip, bone_threshold);
+                coronal_bone = panorama::process_jaw_mask<unsigned char>(coronal_bone);
+                boost::filesystem::create_directories(DST_ROOT / "Coronal Bone Mask");
+                cv::Mat img_coronal_bone = panorama::draw_2d_image<unsigned char>(coronal_bone);
+                output_filename = input_number + ".jpg";
+                output_path = DST_ROOT / "Coronal Bone Mask" / output_filename;
+                writer.write_jpeg(img_coronal_bone, output_path.string());
+            }
 
-        /*
-         * Tilt corrction (regarding sagittal reference plane)
-         */
-        double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<PixelType>(axial_mask);
-        double correction_angle = parida::calc_sagittal_correction_angle(sagittal_tilt_angle);
-        // Rotate around the superior-inferior axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'z', correction_angle);
-        roi_ct = panorama::rotate_ct_image<PixelType>(roi_ct, 'z', correction_angle);
+            if (loaded.axial_mask) {
+                boost::filesystem::create_directories(DST_ROOT / "Axial Mask");
+                cv::Mat img_axial_mask = panorama::draw_2d_image<unsigned char>(loaded.axial_mask);
+                output_filename = input_number + ".jpg";
+                output_path = DST_ROOT / "Axial Mask" / output_filename;
+                writer.write_jpeg(img_axial_mask, output_path.string());
+            }
 
-        /*
-         * Jaw area detection using axial MIP from ROI slices
-         */
-        axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
-        axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
-        axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
-        BoxParam jaw_area_param = parida::calc_jaw_area_param<PixelType>(axial_mask);
+            /*
+             * Tilt correction (regarding sagittal reference plane) and jaw area found by load_case
+             * (the rotated volume is never resampled: MIPs and synthesis interpolate through the pose)
+             */
+            const panorama::TransformedVolume<PixelType> posed_ct(img_ct, panorama::calc_rotation_matrix('z', loaded.correction_angle));
 
-        /*
-         * Tilt correction (regarding axial reference plane)
-         */
-        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        Image2D::Pointer sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
-        sagittal_mask = panorama::process_tooth_mask<PixelType>(sagittal_mask);
-        double axial_tilt_angle = poemi::calc_axial_tilt_angle<PixelType>(sagittal_mask);
-        correction_angle = poemi::calc_axial_correction_angle(axial_tilt_angle);
-
-        boost::filesystem::create_directories(DST_ROOT / "Sagittal MIP");
-        cv::Mat img_sagittal_mip = panorama::draw_2d_image<PixelType>(sagittal_mip);
-        output_filename = input_number + ".jpg";
-        output_path = DST_ROOT / "Sagittal MIP" / output_filename;
-        cv::imwrite(output_path.string(), img_sagittal_mip);
+            /*
+             * Tilt correction (regarding axial reference plane)
+             */
+            Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(posed_ct);
+            panorama::MaskImage::Pointer sagittal_mask = panorama::compute_binary_mask<PixelType>(sagittal_mip, tooth_threshold);
+            sagittal_mask = panorama::process_tooth_mask<unsigned char>(sagittal_mask);
+            double axial_tilt_angle = poemi::calc_axial_tilt_angle<unsigned char>(sagittal_mask);
+            double correction_angle = poemi::calc_axial_correction_angle(axial_tilt_angle);
 
-        // // Rotate around the left-right axis
-        // // img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'x', correction_angle);
-        // // sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        // // sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
+            boost::filesystem::create_directories(DST_ROOT / "Sagittal MIP");
+            cv::Mat img_sagittal_mip = panorama::draw_2d_image<PixelType>(sagittal_mip);
+            output_filename = input_number + ".jpg";
+            output_path = DST_ROOT / "Sagittal MIP" / output_filename;
+            writer.write_jpeg(img_sagittal_mip, output_path.string());
 
-        /*
-         * Sampling CT slice
-         */
-        Range sampling_slice_range = poemi::calc_sampling_slice_range(horizontal_hist);
-        img_ct = panorama::extract_slices<PixelType>(img_ct, sampling_slice_range);
+            // // Rotate around the left-right axis
+            // // img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'x', correction_angle);
+            // // sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
+            // // sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
+
+            /*
+             * Sampling CT slice
+             */
+            const panorama::TransformedVolume<PixelType> sampling_ct = posed_ct.slices(loaded.sampling_slices);
+
+            /*
+             * Synthesis panoramic X-ray Image (ray samples interpolated through the pose)
+             */
+            img_panorama = parida::compute_panoramic_image<PixelType>(sampling_ct, jaw_area_param, false, loaded.corner);
+
+            // Tilt-corrected sampling slices for later runs, cropped to the columns the rays read
+            // (resampled and stored off the compute threads)
+            const cv::Rect sampling_rect = loaded.sampling_rect;
+            Image3D::RegionType sampling_region;
+            sampling_region.SetIndex({sampling_rect.x - loaded.corner.x, sampling_rect.y - loaded.corner.y, 0});
+            sampling_region.SetSize({static_cast<std::size_t>(sampling_rect.width), static_cast<std::size_t>(sampling_rect.height), sampling_ct.size()[2]});
+            writer.submit(loaded.corrected_key, [&volume_cache, key = loaded.corrected_key, sampling_ct = sampling_ct.region(sampling_region),
+                                                 jaw_area_param, sampling_rect] {
+                volume_cache.store<PixelType>(key, sampling_ct.materialize(), {
+                    jaw_area_param.center.x, jaw_area_param.center.y,
+                    jaw_area_param.size.width, jaw_area_param.size.height, jaw_area_param.angle,
+                    static_cast<double>(sampling_rect.x), static_cast<double>(sampling_rect.y)
+                });
+            });
+        } else {
+            /*
+             * Synthesis panoramic X-ray Image (cached tilt-corrected sampling slices)
+             */
+            img_panorama = parida::compute_panoramic_image<PixelType>(img_ct, jaw_area_param, false, loaded.corner);
+        }
+        loaded = LoadedCase();
 
-        /*
-         * Synthesis panoramic X-ray Image
-         */
-        Image2D::Pointer img_panorama = parida::compute_panoramic_image<PixelType>(img_ct, jaw_area_param);
         boost::filesystem::create_directories(DST_ROOT / "Panorama");     
         output_filename = input_number + ".nii.gz";
         output_path = DST_ROOT / "Panorama" / output_filename;
-        panorama::write_image<PixelType, 2>(img_panorama, output_path.string());
+        writer.write_image<PixelType, 2>(img_panorama, output_path.string());
         // debug panorama
         boost::filesystem::create_directories(DST_ROOT / "Debug Panorama");
         cv::Mat img_debug_panorama = panorama::draw_2d_image<PixelType>(img_panorama);
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Debug Panorama" / output_filename;
-        cv::imwrite(output_path.string(), img_debug_panorama);
+        writer.write_jpeg(img_debug_panorama, output_path.string());
 
     }   
+    }
     // std::cout << "[INFO] Main completed normally." << std::endl;
     // std::_Exit(EXIT_SUCCESS);
     return EXIT_SUCCESS;
@@ -2,8 +2,11 @@
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkNiftiImageIO.h>
+#include <type_traits>
 
 #include <image/core.hpp>
+#include <image/mask.hpp>
+#include <image/mat.hpp>
 #include <hist/core.hpp>
 #include <hist/peak.hpp>
 
@@ -78,18 +81,7 @@ panorama::calc_roi_range(const std::vector<short>& curve) {
 // Tilt from Sagittal Reference Plane
 template <typename PixelType>
 double parida::calc_sagittal_tilt_angle(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), const_cast<PixelType*>(img->GetBufferPointer()));
-
-    cv::Mat img_8bit;
-    if (std::is_integral<PixelType>::value) {
-        img_cv.convertTo(img_8bit, CV_8UC1);
-    } else {
-        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
-    }
-
-    cv::Mat binary;
-    cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    cv::Mat binary = panorama::binarize_mask<PixelType>(img);
 
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(binary, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
@@ -112,19 +104,14 @@ double parida::calc_sagittal_correction_angle(const double& angle) {
 // Tilt from Axial Reference Plane
 template <typename PixelType>
 double poemi::calc_axial_tilt_angle(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> it(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++it) {
-            img_cv.at<PixelType>(y, x) = it.Get();
-        }
+    // Contours of the nonzero pixels (8-bit masks are used as they are)
+    cv::Mat img_8bit = img_cv;
+    if constexpr (!std::is_same<PixelType, unsigned char>::value) {
+        img_cv.convertTo(img_8bit, CV_8UC1);
     }
 
-    cv::Mat img_8bit;
-    img_cv.convertTo(img_8bit, CV_8UC1);
-
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(img_8bit, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
@@ -178,9 +165,15 @@ std::pair<short, short> poemi::calc_sampling_slice_range(const std::vector<short
 
 #define PIXEL_TYPE_PARAM(T) \
     template T panorama::calc_tooth_threshold<T>(const std::vector<short> &curve); \
-    template T panorama::calc_bone_threshold<T>(const std::vector<short> &curve); \
+    template T panorama::calc_bone_threshold<T>(const std::vector<short> &curve);
+
+PIXEL_TYPE_PARAM(double)
+PIXEL_TYPE_PARAM(short)
+
+#define MASK_TYPE_PARAM(T) \
     template double parida::calc_sagittal_tilt_angle<T>(const typename itk::Image<T, 2>::Pointer &img); \
     template double poemi::calc_axial_tilt_angle<T>(const typename itk::Image<T, 2>::Pointer &img);
 
-PIXEL_TYPE_PARAM(double)
-PIXEL_TYPE_PARAM(short)
\ No newline at end of file
+MASK_TYPE_PARAM(double)
+MASK_TYPE_PARAM(short)
+MASK_TYPE_PARAM(unsigned char)
\ No newline at end of file
@@ -3,25 +3,20 @@
 #include <itkImageFileWriter.h>
 #include <itkNiftiImageIO.h>
 #include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 #include "synthesis.hpp"
+#include "image/core.hpp"
+#include "image/mask.hpp"
+#include "image/mat.hpp"
+#include "image/view.hpp"
 //#include "image/mip.hpp"
 
 // Calculate Jaw Box Parameter
 template <typename PixelType>
 BoxParam parida::calc_jaw_area_param(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), const_cast<PixelType*>(img->GetBufferPointer()));
-
-    cv::Mat img_8bit;
-    if (std::is_integral<PixelType>::value) {
-        img_cv.convertTo(img_8bit, CV_8UC1);
-    } else {
-        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
-    }
-
-    cv::Mat binary;
-    cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    cv::Mat binary = panorama::binarize_mask<PixelType>(img);
 
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(binary, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
@@ -102,142 +97,247 @@ std::vector<std::pair<int, int>> parida::getPerpendicularLinePixels(
 }
 
 
-// Synthesis Panoramic X-ray Image
-template <typename PixelType>
-typename itk::Image<PixelType, 2>::Pointer parida::compute_panoramic_image(
-    const typename itk::Image<PixelType, 3>::Pointer &img,
-    const BoxParam &box_param
+// Precompute the in-plane voxel offsets of every ray (independent of z)
+RayTable parida::build_ray_table(
+    const BoxParam &box_param,
+    const std::vector<double> &sample_positions,
+    const float &start_angle,
+    const int &ray_length,
+    const std::size_t &width,
+    const std::size_t &height,
+    const cv::Point &corner
 ) {
-    // Set the parameters for the ellipse
-    float h = box_param.center.x;                          // Ellipse center X
-    float k = box_param.center.y + box_param.size.height / 2; // Ellipse center Y
-    float a = 4 * box_param.size.width / 10.0f;            // Ellipse semi-major axis
-    float b = 8 * box_param.size.height / 10.0f;           // Ellipse semi-minor axis
-
-    // Sampling range for angles
-    // float start_angle = 160.0f;
-    // float end_angle = 380.0f;
-    float start_angle = 190.0f;
-    float end_angle = 350.0f;
-
-    // Get slice spacing and number of slices
-    float dx = img->GetSpacing()[0];  // X-spacing
-    float dy = img->GetSpacing()[1];  // Y-spacing
-    float dz = img->GetSpacing()[2];  // Z-spacing
-    size_t z_slices = img->GetLargestPossibleRegion().GetSize(2);  // Number of slices in Z direction
-
-    // Output slice spacing and number of slices
-    /*
-    std::cout << "Slice Spacing: dx = " << dx 
-              << ", dy = " << dy 
-              << ", dz = " << dz << std::endl;
-    std::cout << "Number of z-axis slices: " << z_slices << std::endl;
-    */
-    // Min and max shift values for sampling interval
-    //float mean_shift = (end_angle - start_angle) / 2378;
-    float mean_shift = (end_angle - start_angle) / 1600;
-    float min_shift = mean_shift * 0.8;
-    float max_shift = mean_shift * 1.2;
-    //float z_step = static_cast<float>(z_slices) / 1160;
-    float z_step = static_cast<float>(z_slices) / 600;
-
-    float cumulative_length = 0;
-    std::vector<double> sample_positions;
-
-    // Loop to calculate the sample positions
-    for (float angle = start_angle; angle < end_angle;) {
-        float adaptive_shift = calc_shift_step(angle, min_shift, max_shift, a, b);
+    float h = box_param.center.x;
+    float k = box_param.center.y + box_param.size.height / 2;
+    float a = 4 * box_param.size.width / 10.0f;
+    float b = 8 * box_param.size.height / 10.0f;
 
-        // Fixed sampling interval for 160~180 and 360~380 degrees
-        if ((angle >= 160.0f && angle < 180.0f) || (angle > 360.0f && angle <= 380.0f)) {
-            adaptive_shift = max_shift;
+    RayTable table;
+    table.column_begin.reserve(sample_positions.size() + 1);
+    table.offsets.reserve(sample_positions.size() * ray_length);
+    table.column_begin.push_back(0);
+
+    for (size_t i = 0; i < sample_positions.size(); i++) {
+        float angle = start_angle + sample_positions[i];
+        float theta = angle * M_PI / 180.0f;
+
+        // Calculate X and Y positions based on the angle
+        float x = h + a * cos(theta);
+        float y = k + b * sin(theta);
+
+        // Calculate the rotation center based on the reverse angle
+        float reverse_angle = 540.0f - angle;
+        float asteroid_theta = reverse_angle * M_PI / 180.0f;
+
+        float rotation_center_x = h + (box_param.size.width / 2.0f) * std::pow(std::cos(asteroid_theta), 3);
+        float rotation_center_y = k + (box_param.size.height / 2.0f) * std::pow(std::sin(asteroid_theta), 3);
+        cv::Point rotation_center(cvRound(rotation_center_x), cvRound(rotation_center_y));
+
+        // Calculate the ray slope
+        float ray_slope = (y - rotation_center.y) / (x - rotation_center.x);
+        std::vector<std::pair<int, int>> perp_pixels = getPerpendicularLinePixels(x, y, ray_slope, ray_length);
+
+        // Keep only the pixels inside the slice
+        for (const auto &pixel : perp_pixels) {
+            const long px = pixel.first - corner.x;
+            const long py = pixel.second - corner.y;
+            if (px >= 0 && px < static_cast<long>(width) && py >= 0 && py < static_cast<long>(height)) {
+                table.offsets.push_back(static_cast<std::ptrdiff_t>(py * static_cast<long>(width) + px));
+            }
         }
+        table.column_begin.push_back(table.offsets.size());
+    }
 
-        cumulative_length += adaptive_shift;
-        sample_positions.push_back(cumulative_length);
+    return table;
+}
 
-        // Update angle for next sample position
-        angle += adaptive_shift;
-    }
 
-    // Determine the size of the panoramic image
-    typename itk::Image<PixelType, 2>::SizeType size_img;
-    size_img[0] = sample_positions.size();  // Width (number of samples)
-    size_img[1] = img->GetLargestPossibleRegion().GetSize(2) / z_step;  // Height (number of slices)
-
-    // Output the size of the panoramic image
-    /*
-    std::cout << "Panoramic Image Size (Sampling Count): Width = " << size_img[0]
-              << ", Height = " << size_img[1] << std::endl;
-    */
-    typename itk::Image<PixelType, 2>::RegionType region;
-    region.SetSize(size_img);
-    region.SetIndex({0, 0});
+// Bounding rectangle of the rays: arch points (ellipse between START_ANGLE and END_ANGLE) +- half a ray
+cv::Rect parida::calc_sampling_rect(const BoxParam &box_param, const std::size_t &width, const std::size_t &height) {
+    const double h = box_param.center.x;
+    const double k = box_param.center.y + box_param.size.height / 2;
+    const double a = 4 * box_param.size.width / 10.0;
+    const double b = 8 * box_param.size.height / 10.0;
+
+    // sin over the sampled angles (the last sample may pass END_ANGLE by one shift step)
+    const double first = START_ANGLE, last = END_ANGLE + 1.0;
+    auto passes = [&](const double &peak) {
+        return peak + 360.0 * std::ceil((first - peak) / 360.0) <= last;
+    };
+    const double sin_first = std::sin(first * M_PI / 180.0);
+    const double sin_last = std::sin(last * M_PI / 180.0);
+    const double sin_min = passes(270.0) ? -1.0 : std::min(sin_first, sin_last);
+    const double sin_max = passes(90.0) ? 1.0 : std::max(sin_first, sin_last);
+
+    // Rays are centred on the arch; one more pixel for rounding
+    const double reach = RAY_LENGTH / 2.0 + 1;
+    const int x0 = std::max(static_cast<int>(std::floor(h - a - reach)), 0);
+    const int y0 = std::max(static_cast<int>(std::floor(k + b * sin_min - reach)), 0);
+    const int x1 = std::min(static_cast<int>(std::ceil(h + a + reach)) + 1, static_cast<int>(width));
+    const int y1 = std::min(static_cast<int>(std::ceil(k + b * sin_max + reach)) + 1, static_cast<int>(height));
+
+    return cv::Rect(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+}
 
-    // Initialize the 2D panoramic image
-    typename itk::Image<PixelType, 2>::Pointer img2d = itk::Image<PixelType, 2>::New();
-    img2d->SetRegions(region);
-    img2d->Allocate();
-    img2d->FillBuffer(0);
 
-    // Loop to generate the panoramic image
-    for (double z = 0; z < img->GetLargestPossibleRegion().GetSize(2); z += z_step) {
-        size_t rounded_z = static_cast<size_t>(std::round(z));
-        if (rounded_z >= img->GetLargestPossibleRegion().GetSize(2)) {
-            break;
-        }
+namespace {
+    // Panorama geometry and ray averaging shared by the image and posed-volume inputs.
+    // sample(z, offset) reads slice z at the in-plane offset y * width + x, relative to corner.
+    template <typename PixelType, typename Sampler>
+    typename itk::Image<PixelType, 2>::Pointer synthesize_panoramic_image(
+        const typename itk::Image<PixelType, 3>::SizeType &size3d,
+        const BoxParam &box_param,
+        const bool &clamp,
+        const cv::Point &corner,
+        const Sampler &sample
+    ) {
+        // Set the parameters for the ellipse
+        float a = 4 * box_param.size.width / 10.0f;            // Ellipse semi-major axis
+        float b = 8 * box_param.size.height / 10.0f;           // Ellipse semi-minor axis
+
+        // Sampling range for angles
+        // float start_angle = 160.0f;
+        // float end_angle = 380.0f;
+        float start_angle = parida::START_ANGLE;
+        float end_angle = parida::END_ANGLE;
+
+        size_t z_slices = size3d[2];  // Number of slices in Z direction
+
+        // Min and max shift values for sampling interval
+        //float mean_shift = (end_angle - start_angle) / 2378;
+        float mean_shift = (end_angle - start_angle) / 1600;
+        float min_shift = mean_shift * 0.8;
+        float max_shift = mean_shift * 1.2;
+        //float z_step = static_cast<float>(z_slices) / 1160;
+        float z_step = static_cast<float>(z_slices) / 600;
+
+        float cumulative_length = 0;
+        std::vector<double> sample_positions;
+
+        // Loop to calculate the sample positions
+        for (float angle = start_angle; angle < end_angle;) {
+            float adaptive_shift = parida::calc_shift_step(angle, min_shift, max_shift, a, b);
+
+            // Fixed sampling interval for 160~180 and 360~380 degrees
+            if ((angle >= 160.0f && angle < 180.0f) || (angle > 360.0f && angle <= 380.0f)) {
+                adaptive_shift = max_shift;
+            }
 
-        for (size_t i = 0; i < sample_positions.size(); i++) {
-            float angle = start_angle + sample_positions[i];
-            float theta = angle * M_PI / 180.0f;
+            cumulative_length += adaptive_shift;
+            sample_positions.push_back(cumulative_length);
 
-            // Calculate X and Y positions based on the angle
-            float x = h + a * cos(theta);
-            float y = k + b * sin(theta);
+            // Update angle for next sample position
+            angle += adaptive_shift;
+        }
 
-            // Calculate the rotation center based on the reverse angle
-            float reverse_angle = 540.0f - angle;
-            float asteroid_theta = reverse_angle * M_PI / 180.0f;
+        // Determine the size of the panoramic image
+        typename itk::Image<PixelType, 2>::SizeType size_img;
+        size_img[0] = sample_positions.size();  // Width (number of samples)
+        size_img[1] = z_slices / z_step;        // Height (number of slices)
+
+        typename itk::Image<PixelType, 2>::RegionType region;
+        region.SetSize(size_img);
+        region.SetIndex({0, 0});
+
+        // Initialize the 2D panoramic image
+        typename itk::Image<PixelType, 2>::Pointer img2d = itk::Image<PixelType, 2>::New();
+        img2d->SetRegions(region);
+        img2d->Allocate();
+        img2d->FillBuffer(0);
+
+        // Ray geometry does not depend on z: build it once, then offset by slice
+        const size_t width = size3d[0];
+        const size_t height = size3d[1];
+        const RayTable ray_table = parida::build_ray_table(box_param, sample_positions, start_angle, parida::RAY_LENGTH, width, height, corner);
+
+        // Integral volumes are summed exactly in 64 bits; widening happens only inside the kernel
+        using Accumulator = std::conditional_t<std::is_integral_v<PixelType>, std::int64_t, double>;
+
+        // Sample range: the usual HU guard, or the CT window when the volume was not windowed
+        const PixelType sample_min = static_cast<PixelType>(-1024);
+        const PixelType sample_max = static_cast<PixelType>(clamp ? panorama::HU_MAX : 4095);
+
+        PixelType* panorama = img2d->GetBufferPointer();
+        const PixelType* previous_row = nullptr;
+        size_t previous_z = 0;
+
+        // Loop to generate the panoramic image
+        for (double z = 0; z < z_slices; z += z_step) {
+            size_t rounded_z = static_cast<size_t>(std::round(z));
+            if (rounded_z >= z_slices) {
+                break;
+            }
 
-            float rotation_center_x = h + (box_param.size.width / 2.0f) * std::pow(std::cos(asteroid_theta), 3);
-            float rotation_center_y = k + (box_param.size.height / 2.0f) * std::pow(std::sin(asteroid_theta), 3);
-            cv::Point rotation_center(cvRound(rotation_center_x), cvRound(rotation_center_y));
+            const size_t row = static_cast<size_t>(z / z_step);
+            if (row >= size_img[1]) {
+                break;
+            }
 
-            // Calculate the ray slope
-            float ray_slope = (y - rotation_center.y) / (x - rotation_center.x);
-            std::vector<std::pair<int, int>> perp_pixels = getPerpendicularLinePixels(x, y, ray_slope, 200);
+            PixelType* panorama_row = panorama + row * size_img[0];
 
-            double sum = 0;
-            int valid_pixel_count = 0;
+            // z_step < 1 repeats slices: rows of the same slice are identical
+            if (previous_row && rounded_z == previous_z) {
+                std::copy(previous_row, previous_row + size_img[0], panorama_row);
+                continue;
+            }
 
-            // Loop to calculate the pixel values for the panoramic image
-            for (const auto &pixel : perp_pixels) {
-                size_t normalX = static_cast<long>(pixel.first);
-                size_t normalY = static_cast<long>(pixel.second);
+            for (size_t i = 0; i < sample_positions.size(); i++) {
+                const size_t begin = ray_table.column_begin[i];
+                const size_t end = ray_table.column_begin[i + 1];
 
-                if (normalX >= 0 && normalX < img->GetLargestPossibleRegion().GetSize(0) &&
-                    normalY >= 0 && normalY < img->GetLargestPossibleRegion().GetSize(1)) {
-                    typename itk::Image<PixelType, 3>::IndexType idx3 = {static_cast<long>(normalX), static_cast<long>(normalY), static_cast<long>(rounded_z)};
-                    auto pixel_value = img->GetPixel(idx3);
-                    if constexpr (std::is_same_v<PixelType, double>) {
-                        pixel_value = std::clamp(pixel_value, -1024.0, 4095.0);
-                    } else if constexpr (std::is_same_v<PixelType, short>) {
-                        pixel_value = std::clamp(pixel_value, static_cast<short>(-1024), static_cast<short>(4095));
-                    }
-                    //pixel_value = std::clamp(pixel_value, static_cast<short>(-1024), static_cast<short>(4095));
-                    sum += pixel_value;
-                    valid_pixel_count++;
+                Accumulator sum = 0;
+                for (size_t j = begin; j < end; j++) {
+                    sum += std::clamp(sample(rounded_z, ray_table.offsets[j]), sample_min, sample_max);
                 }
+
+                // Compute the panoramic value (average pixel value)
+                const size_t valid_pixel_count = end - begin;
+                double panoramic_value = valid_pixel_count > 0 ? static_cast<double>(sum) / valid_pixel_count : 0;
+                panorama_row[i] = static_cast<short>(panoramic_value);
             }
 
-            // Compute the panoramic value (average pixel value)
-            double panoramic_value = valid_pixel_count > 0 ? sum / valid_pixel_count : 0;
-            typename itk::Image<PixelType, 2>::IndexType idx2 = {static_cast<long>(i), static_cast<long>(z / z_step)};
-            img2d->SetPixel(idx2, static_cast<short>(panoramic_value));
+            previous_row = panorama_row;
+            previous_z = rounded_z;
         }
+
+        return img2d;
     }
+}
 
-    return img2d;
+
+// Synthesis Panoramic X-ray Image
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer parida::compute_panoramic_image(
+    const typename itk::Image<PixelType, 3>::Pointer &img,
+    const BoxParam &box_param,
+    const bool &clamp,
+    const cv::Point &corner
+) {
+    const auto size3d = img->GetLargestPossibleRegion().GetSize();
+    const std::ptrdiff_t slice_stride = static_cast<std::ptrdiff_t>(size3d[0] * size3d[1]);
+    const PixelType* buffer = img->GetBufferPointer();
+
+    return synthesize_panoramic_image<PixelType>(size3d, box_param, clamp, corner,
+        [buffer, slice_stride](const size_t &z, const std::ptrdiff_t &offset) {
+            return buffer[z * slice_stride + offset];
+        });
+}
+
+
+// Synthesis Panoramic X-ray Image from a posed volume (only the ray samples are interpolated)
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer parida::compute_panoramic_image(
+    const panorama::TransformedVolume<PixelType> &view,
+    const BoxParam &box_param,
+    const bool &clamp,
+    const cv::Point &corner
+) {
+    const std::ptrdiff_t width = static_cast<std::ptrdiff_t>(view.size()[0]);
+
+    return synthesize_panoramic_image<PixelType>(view.size(), box_param, clamp, corner,
+        [&view, width](const size_t &z, const std::ptrdiff_t &offset) {
+            return view.sample(static_cast<double>(offset % width), static_cast<double>(offset / width), static_cast<double>(z));
+        });
 }
 
 //  for Multi Synthesis
@@ -380,9 +480,16 @@ poemi::compute_panoramic_image(
 
 
 #define PIXEL_TYPE_SYNTHESIS(T) \
-    template BoxParam parida::calc_jaw_area_param<T>(const typename itk::Image<T, 2>::Pointer &img); \
-    template itk::Image<T, 2>::Pointer parida::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param); \
+    template itk::Image<T, 2>::Pointer parida::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const bool &clamp, const cv::Point &corner); \
+    template itk::Image<T, 2>::Pointer parida::compute_panoramic_image<T>(const panorama::TransformedVolume<T> &view, const BoxParam &box_param, const bool &clamp, const cv::Point &corner); \
     template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const std::string &aggregation_method);
 
 PIXEL_TYPE_SYNTHESIS(double)
-PIXEL_TYPE_SYNTHESIS(short)
\ No newline at end of file
+PIXEL_TYPE_SYNTHESIS(short)
+
+#define MASK_TYPE_SYNTHESIS(T) \
+    template BoxParam parida::calc_jaw_area_param<T>(const typename itk::Image<T, 2>::Pointer &img);
+
+MASK_TYPE_SYNTHESIS(double)
+MASK_TYPE_SYNTHESIS(short)
+MASK_TYPE_SYNTHESIS(unsigned char)
\ No newline at end of file
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include <opencv2/opencv.hpp>
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 
 #define PARAM_DIM 7
 
-typedef double PixelType;
+typedef short PixelType;
 
 using Image3D = itk::Image<PixelType, 3>;
 using Image2D = itk::Image<PixelType, 2>;
@@ -20,6 +24,21 @@ struct BoxParam {
     float angle;          // 回転角度（度）
 };
 
+// Per-column ray samples, stored as flattened in-plane offsets (y * width + x)
+struct RayTable {
+    std::vector<std::size_t> column_begin;    // ray i spans offsets[column_begin[i] .. column_begin[i + 1])
+    std::vector<std::ptrdiff_t> offsets;
+};
+
+// Rays sampled from the centre outwards, stored as flattened in-plane offsets (y * width + x).
+// A shorter ray is a prefix of a longer one, so nested ray lengths share partial sums.
+struct NestedRayTable {
+    std::vector<int> ray_lengths;               // ascending, unique
+    std::vector<std::size_t> column_begin;      // ray i spans offsets[column_begin[i] .. column_begin[i + 1])
+    std::vector<std::size_t> length_end;        // ray i cut at ray_lengths[j] ends at length_end[i * ray_lengths.size() + j]
+    std::vector<std::ptrdiff_t> offsets;
+};
+
 namespace parida {
     template <typename PixelType>
     BoxParam calc_jaw_area_param(const typename itk::Image<PixelType, 2>::Pointer&);
@@ -31,6 +50,18 @@ namespace parida {
         double cx, double cy, double normalSlope, int length
     );
 
+    // corner: in-plane index of the image's first voxel in the slice the box was detected on
+    // (offsets are relative to it, pixels outside the image are dropped)
+    RayTable build_ray_table(
+        const BoxParam&,
+        const std::vector<double>&,                     // サンプリング位置（角度の累積）
+        const float&,                                   // 開始角度
+        const int&,                                     // 光線長さ
+        const std::size_t&,                             // 画像幅
+        const std::size_t&,                             // 画像高さ
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer compute_panoramic_image(
         const typename itk::Image<PixelType, 3>::Pointer&, 
@@ -39,11 +70,109 @@ namespace parida {
 }
 
 namespace poemi {
+    // Aggregation policies: accumulate() reduces a run of clamped ray samples (delta = sample spacing),
+    // finalize() turns the reduction into the panoramic value of one pixel.
+    // Sums run in sample order (no reassociation) so the output matches the per-sample loop bit for bit;
+    // only the max, which is order-independent, is vectorized.
+    struct MeanAggregation {
+        double sum = 0.0;
+
+        void accumulate(const double* values, const std::size_t& n, const double&) {
+            for (std::size_t i = 0; i < n; i++) sum += values[i];
+        }
+        double finalize(const std::size_t& count, const double&) const {
+            return sum / count;
+        }
+    };
+
+    struct MaxAggregation {
+        double max_val = std::numeric_limits<double>::lowest();
+
+        void accumulate(const double* values, const std::size_t& n, const double&) {
+            double m = max_val;
+            #pragma omp simd reduction(max:m)
+            for (std::size_t i = 0; i < n; i++) m = std::max(m, values[i]);
+            max_val = m;
+        }
+        double finalize(const std::size_t&, const double&) const {
+            return max_val;
+        }
+    };
+
+    struct LogSumExpAggregation {
+        static constexpr double S = 300;
+        double exp_sum = 0.0;
+
+        void accumulate(const double* values, const std::size_t& n, const double&) {
+            for (std::size_t i = 0; i < n; i++) exp_sum += std::exp(values[i] / S);
+        }
+        double finalize(const std::size_t&, const double&) const {
+            return S * std::log(exp_sum);
+        }
+    };
+
+    struct TransmittanceAggregation {
+        static constexpr double beta = 0.5;
+        double trans_sum = 0.0;                         // 正規化した値 × delta の和
+
+        void accumulate(const double* values, const std::size_t& n, const double& delta) {
+            for (std::size_t i = 0; i < n; i++) trans_sum += std::clamp(values[i], 0.0, 3071.0) / 3071.0 * delta;
+        }
+        double finalize(const std::size_t&, const double&) const {
+            double attenuation = std::clamp(beta * trans_sum, 0.0, 20.0);
+            return (1.0 - std::exp(-attenuation)) * 4095.0;
+        }
+    };
+
+    std::vector<double> calc_sample_positions(float start_angle, float end_angle, float mean_shift, float a, float b);
+
+    std::vector<std::pair<int, int>> getOutwardLinePixels(
+        double cx, double cy, double normalSlope, int length
+    );
+
+    // corner: as for parida::build_ray_table
+    NestedRayTable build_nested_ray_table(
+        const BoxParam&,
+        const std::vector<double>&,                     // サンプリング位置（角度の累積）
+        const float&,                                   // 開始角度
+        const std::vector<int>&,                        // 光線長さ
+        const std::size_t&,                             // 画像幅
+        const std::size_t&,                             // 画像高さ
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
+    // In-plane rectangle of a width x height slice holding every sample of rays up to the given length:
+    // sampling slices cropped to it give the same panoramas (pass its top-left as corner)
+    cv::Rect calc_sampling_rect(const BoxParam&, const int&, const std::size_t&, const std::size_t&);
+
+    // corner: in-plane index of the volume's first voxel (for volumes cropped to calc_sampling_rect)
+    template <typename PixelType, typename Aggregation>
+    typename itk::Image<PixelType, 2>::Pointer compute_panoramic_image(
+        const typename itk::Image<PixelType, 3>::Pointer&, 
+        const BoxParam&,
+        const int&,                                     // 光線長さ（例：200）
+        const bool& clamp = false,                      // 読み出し時に [HU_MIN, HU_MAX] へ窓処理
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
+    // "mean" / "max" / "logarithm" / "transmittance" -> policy dispatch
     template <typename PixelType>
     typename itk::Image<PixelType, 2>::Pointer compute_panoramic_image(
         const typename itk::Image<PixelType, 3>::Pointer&, 
         const BoxParam&,
         const int&,                                     // 光線長さ（例：200）
-        const std::string&
+        const std::string&,
+        const bool& clamp = false,                      // 読み出し時に [HU_MIN, HU_MAX] へ窓処理
+        const cv::Point& corner = cv::Point(0, 0)
+    );
+
+    // One sweep for several (aggregation, ray length) pairs; images are returned in task order
+    template <typename PixelType>
+    std::vector<typename itk::Image<PixelType, 2>::Pointer> compute_panoramic_images(
+        const typename itk::Image<PixelType, 3>::Pointer&,
+        const BoxParam&,
+        const std::vector<std::pair<std::string, int>>&,
+        const bool& clamp = false,                      // 読み出し時に [HU_MIN, HU_MAX] へ窓処理
+        const cv::Point& corner = cv::Point(0, 0)
     );
 }
\ No newline at end of file
@@ -9,7 +9,10 @@
 #include <utils/dataset.hpp>
 #include <image/core.hpp>
 #include <image/io.hpp>
+#include <image/writer.hpp>
+#include <image/nifti.hpp>
 #include <image/mip.hpp>
+#include <image/view.hpp>
 #include <image/mask.hpp>
 
 #include <hist/core.hpp>
@@ -29,6 +32,10 @@ int main() {
     const auto DST_ROOT = HOME / "workspace" / "kobe" / "synthesis" / "_out" / "mronj" / "multi";
     
     const utils::Dataset dataset(SRC_ROOT / "data.yml");
+    // Artifacts are encoded and written off the compute threads
+    const std::size_t WRITER_THREADS = 2;
+    panorama::AsyncWriter writer(WRITER_THREADS);
+
     #pragma omp parallel for 
     //for (size_t i = 0; i < dataset.size(); i++) {
     for (size_t i = 0; i < 1; i++) {
@@ -42,11 +49,15 @@ int main() {
         std::cout << input_number << std::endl;
         std::string output_filename = "vanitas vanitatum, et omnia vanitas" + input_number;
         boost::filesystem::path output_path = DST_ROOT / output_filename;
+        // .nii.gz inputs are decompressed once into the cache so later runs can map them
+        const std::string ct_path = panorama::cache_nifti(ct_image_path.string(), (DST_ROOT / "Cache").string());
         Image3D::Pointer img_ct = panorama::read_image<PixelType>(
-            ct_image_path.string()
+            ct_path
         );
         
-        img_ct = panorama::window_ct_image<PixelType>(img_ct);
+        panorama::window_ct_image_inplace<PixelType>(img_ct);
+        // Isotropic voxels (slices resampled to the in-plane spacing) before any slice range is derived
+        img_ct = panorama::resampling_ct_image<PixelType>(img_ct);
         Image2D::Pointer coronal_mip = panorama::compute_coronal_mip_image<PixelType>(img_ct);
         /*
          * Calculate threshold using coronal MIP 
@@ -58,8 +69,8 @@ int main() {
         /*
          * Calculate ROI range using horizontal histogram
          */
-        Image2D::Pointer coronal_mask = panorama::compute_mask_image(coronal_mip, tooth_threshold);
-        Hist horizontal_hist = panorama::compute_horizontal_histogram<PixelType>(coronal_mask, tooth_threshold);
+        panorama::BitMask coronal_mask = panorama::compute_bit_mask<PixelType>(coronal_mip, tooth_threshold);
+        Hist horizontal_hist = panorama::compute_horizontal_histogram(coronal_mask);
         Hist horizontal_curve = panorama::compute_horizontal_curve(horizontal_hist);
         Range roi_range = panorama::calc_roi_range(horizontal_curve);
         
@@ -68,45 +79,65 @@ int main() {
          */
         Image3D::Pointer roi_ct = panorama::extract_slices<PixelType>(img_ct, roi_range);
         Image2D::Pointer axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
-        Image2D::Pointer axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
-        axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
+        panorama::MaskImage::Pointer axial_mask = panorama::compute_binary_mask<PixelType>(axial_mip, bone_threshold);
+        axial_mask = panorama::process_jaw_mask<unsigned char>(axial_mask);
 
         /*
          * Tilt corrction (regarding sagittal reference plane)
          */
-        double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<PixelType>(axial_mask);
+        double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<unsigned char>(axial_mask);
         double correction_angle = parida::calc_sagittal_correction_angle(sagittal_tilt_angle);
         // Rotate around the superior-inferior axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'z', correction_angle);
-        roi_ct = panorama::rotate_ct_image<PixelType>(roi_ct, 'z', correction_angle);
+        // (rotations are accumulated in pose; MIPs interpolate through it, only the sampling slices are resampled)
+        itk::Matrix<double, 3, 3> pose = panorama::calc_rotation_matrix('z', correction_angle);
+        const panorama::TransformedVolume<PixelType> posed_ct(img_ct, pose);
   
         /*
          * Jaw area detection using axial MIP from ROI slices
          */
-        axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
-        axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
-        axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
-        BoxParam jaw_area_param = parida::calc_jaw_area_param<PixelType>(axial_mask);
+        axial_mip = panorama::compute_axial_mip_image<PixelType>(posed_ct.slices(roi_range));
+        axial_mask = panorama::compute_binary_mask<PixelType>(axial_mip, bone_threshold);
+        axial_mask = panorama::process_jaw_mask<unsigned char>(axial_mask);
+        BoxParam jaw_area_param = parida::calc_jaw_area_param<unsigned char>(axial_mask);
 
         /*
          * Tilt correction (regarding axial reference plane)
          */
-        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        Image2D::Pointer sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
-        sagittal_mask = panorama::process_tooth_mask<PixelType>(sagittal_mask);
-        double axial_tilt_angle = poemi::calc_axial_tilt_angle<PixelType>(sagittal_mask);
+        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(posed_ct);
+        panorama::MaskImage::Pointer sagittal_mask = panorama::compute_binary_mask<PixelType>(sagittal_mip, tooth_threshold);
+        sagittal_mask = panorama::process_tooth_mask<unsigned char>(sagittal_mask);
+        double axial_tilt_angle = poemi::calc_axial_tilt_angle<unsigned char>(sagittal_mask);
         correction_angle = poemi::calc_axial_correction_angle(axial_tilt_angle);
 
         // Rotate around the left-right axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'x', correction_angle);
-        sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
+        pose = pose * panorama::calc_rotation_matrix('x', correction_angle);
 
         /*
          * Sampling CT slice
          */
         Range sampling_slice_range = poemi::calc_sampling_slice_range(horizontal_hist);
-        img_ct = panorama::extract_slices<PixelType>(img_ct, sampling_slice_range);
+
+        std::vector<std::string> aggregation_methods = {"mean", "logarithm", "transmittance", "max"};
+        std::vector<std::pair<std::string, int>> tasks;
+        int max_ray_length = 0;
+        for (const auto &method : aggregation_methods) {
+            for (int ray_length = 80; ray_length <= 200; ray_length += 60) {
+                tasks.emplace_back(method, ray_length);
+                max_ray_length = std::max(max_ray_length, ray_length);
+            }
+        }
+
+        // Single resampling of the corrected pose, cropped to the sampling slices and
+        // to the columns the longest rays read (three shears when only one tilt was corrected)
+        const auto ct_size = img_ct->GetLargestPossibleRegion().GetSize();
+        const cv::Rect sampling_rect = poemi::calc_sampling_rect(jaw_area_param, max_ray_length, ct_size[0], ct_size[1]);
+        Image3D::RegionType sampling_region;
+        sampling_region.SetIndex({sampling_rect.x, sampling_rect.y, sampling_slice_range.first});
+        sampling_region.SetSize({
+            static_cast<std::size_t>(sampling_rect.width), static_cast<std::size_t>(sampling_rect.height),
+            static_cast<std::size_t>(std::max(sampling_slice_range.second - sampling_slice_range.first, 0))
+        });
+        img_ct = panorama::transform_ct_image<PixelType>(img_ct, pose, sampling_region, panorama::RotationEngine::Shear);
 
         /*
          * Synthesis panoramic X-ray Image
@@ -125,13 +156,9 @@ int main() {
         /*
          * Synthesis multi panoramic X-ray Image
          */
-        std::vector<std::string> aggregation_methods = {"mean", "logarithm", "transmittance", "max"};
-        std::vector<std::pair<std::string, int>> tasks;
-        for (const auto &method : aggregation_methods) {
-            for (int ray_length = 80; ray_length <= 200; ray_length += 60) {
-                tasks.emplace_back(method, ray_length);
-            }
-        }
+        std::vector<Image2D::Pointer> img_panoramas = poemi::compute_panoramic_images<PixelType>(
+            img_ct, jaw_area_param, tasks, false, cv::Point(sampling_rect.x, sampling_rect.y)
+        );
         for (int idx = 0; idx < static_cast<int>(tasks.size()); ++idx) {
             const auto &[method, ray_length] = tasks[idx];
         
@@ -141,18 +168,16 @@ int main() {
             boost::filesystem::create_directories(dir_nifti);
             boost::filesystem::create_directories(dir_jpg);
         
-            Image2D::Pointer img_panorama = poemi::compute_panoramic_image<PixelType>(
-                img_ct, jaw_area_param, ray_length, method
-            );
+            const Image2D::Pointer &img_panorama = img_panoramas[idx];
             
             std::string output_filename = input_number + ".nii.gz";
             boost::filesystem::path output_path = dir_nifti / output_filename;
-            panorama::write_image<PixelType, 2>(img_panorama, output_path.string());
+            writer.write_image<PixelType, 2>(img_panorama, output_path.string());
             
             cv::Mat jpg_panorama = parida::draw_2d_image<PixelType>(img_panorama);
             output_filename = input_number + ".jpg";
             output_path = dir_jpg / output_filename;
-            cv::imwrite(output_path.string(), jpg_panorama);
+            writer.write_jpeg(jpg_panorama, output_path.string());
         }
         
     }   
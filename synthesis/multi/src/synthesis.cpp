@@ -5,23 +5,15 @@
 #include <algorithm>
 
 #include "synthesis.hpp"
+#include "image/core.hpp"
+#include "image/mask.hpp"
+#include "image/mat.hpp"
 //#include "image/mip.hpp"
 
 // Calculate Jaw Box Parameter
 template <typename PixelType>
 BoxParam parida::calc_jaw_area_param(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), const_cast<PixelType*>(img->GetBufferPointer()));
-
-    cv::Mat img_8bit;
-    if (std::is_integral<PixelType>::value) {
-        img_cv.convertTo(img_8bit, CV_8UC1);
-    } else {
-        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
-    }
-
-    cv::Mat binary;
-    cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+    cv::Mat binary = panorama::binarize_mask<PixelType>(img);
 
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(binary, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
@@ -102,6 +94,61 @@ std::vector<std::pair<int, int>> parida::getPerpendicularLinePixels(
 }
 
 
+// Precompute the in-plane voxel offsets of every ray (independent of z)
+RayTable parida::build_ray_table(
+    const BoxParam &box_param,
+    const std::vector<double> &sample_positions,
+    const float &start_angle,
+    const int &ray_length,
+    const std::size_t &width,
+    const std::size_t &height,
+    const cv::Point &corner
+) {
+    float h = box_param.center.x;
+    float k = box_param.center.y + box_param.size.height / 2;
+    float a = 4 * box_param.size.width / 10.0f;
+    float b = 8 * box_param.size.height / 10.0f;
+
+    RayTable table;
+    table.column_begin.reserve(sample_positions.size() + 1);
+    table.offsets.reserve(sample_positions.size() * ray_length);
+    table.column_begin.push_back(0);
+
+    for (size_t i = 0; i < sample_positions.size(); i++) {
+        float angle = start_angle + sample_positions[i];
+        float theta = angle * M_PI / 180.0f;
+
+        // Calculate X and Y positions based on the angle
+        float x = h + a * cos(theta);
+        float y = k + b * sin(theta);
+
+        // Calculate the rotation center based on the reverse angle
+        float reverse_angle = 540.0f - angle;
+        float asteroid_theta = reverse_angle * M_PI / 180.0f;
+
+        float rotation_center_x = h + (box_param.size.width / 2.0f) * std::pow(std::cos(asteroid_theta), 3);
+        float rotation_center_y = k + (box_param.size.height / 2.0f) * std::pow(std::sin(asteroid_theta), 3);
+        cv::Point rotation_center(cvRound(rotation_center_x), cvRound(rotation_center_y));
+
+        // Calculate the ray slope
+        float ray_slope = (y - rotation_center.y) / (x - rotation_center.x);
+        std::vector<std::pair<int, int>> perp_pixels = getPerpendicularLinePixels(x, y, ray_slope, ray_length);
+
+        // Keep only the pixels inside the slice
+        for (const auto &pixel : perp_pixels) {
+            const long px = pixel.first - corner.x;
+            const long py = pixel.second - corner.y;
+            if (px >= 0 && px < static_cast<long>(width) && py >= 0 && py < static_cast<long>(height)) {
+                table.offsets.push_back(static_cast<std::ptrdiff_t>(py * static_cast<long>(width) + px));
+            }
+        }
+        table.column_begin.push_back(table.offsets.size());
+    }
+
+    return table;
+}
+
+
 // Synthesis Panoramic X-ray Image
 template <typename PixelType>
 typename itk::Image<PixelType, 2>::Pointer parida::compute_panoramic_image(
@@ -236,41 +283,169 @@ typename itk::Image<PixelType, 2>::Pointer parida::compute_panoramic_image(
     return img2d;
 }
 
+// Cumulative angular sample positions along the dental arch
+std::vector<double> poemi::calc_sample_positions(float start_angle, float end_angle, float mean_shift, float a, float b) {
+    float min_shift = mean_shift * 0.8;
+    float max_shift = mean_shift * 1.2;
+
+    std::vector<double> sample_positions;
+    for (float angle = start_angle, cumulative_length = 0; angle < end_angle;) {
+        float adaptive_shift = parida::calc_shift_step(angle, min_shift, max_shift, a, b);
+        if ((angle >= 160.0f && angle < 180.0f) || (angle > 360.0f && angle <= 380.0f)) {
+            adaptive_shift = max_shift;
+        }
+        cumulative_length += adaptive_shift;
+        sample_positions.push_back(cumulative_length);
+        angle += adaptive_shift;
+    }
+
+    return sample_positions;
+}
+
+
+// Unit-spaced pixels along the perpendicular line, ordered from the centre outwards
+// (-0.5, +0.5, -1.5, +1.5, ...), so the first n pixels form the ray of length n
+std::vector<std::pair<int, int>> poemi::getOutwardLinePixels(
+    double cx, double cy, double normalSlope, int length
+) {
+    std::vector<std::pair<int, int>> pixels;
+    pixels.reserve(length);
+
+    double ux = 1.0 / std::sqrt(1 + normalSlope * normalSlope);
+    double uy = normalSlope * ux;
+
+    for (int i = 0; i < length; i++) {
+        double distance = (i / 2 + 0.5) * (i % 2 == 0 ? -1.0 : 1.0);
+        int x = static_cast<int>(std::round(cx + distance * ux));
+        int y = static_cast<int>(std::round(cy + distance * uy));
+        pixels.emplace_back(x, y);
+    }
+
+    return pixels;
+}
+
+
+// Precompute centre-outward rays once for all requested ray lengths
+NestedRayTable poemi::build_nested_ray_table(
+    const BoxParam &box_param,
+    const std::vector<double> &sample_positions,
+    const float &start_angle,
+    const std::vector<int> &ray_lengths,
+    const std::size_t &width,
+    const std::size_t &height,
+    const cv::Point &corner
+) {
+    float h = box_param.center.x;
+    float k = box_param.center.y + box_param.size.height / 2;
+    float a = 4 * box_param.size.width / 10.0f;
+    float b = 8 * box_param.size.height / 10.0f;
+
+    NestedRayTable table;
+    table.ray_lengths = ray_lengths;
+    std::sort(table.ray_lengths.begin(), table.ray_lengths.end());
+    table.ray_lengths.erase(std::unique(table.ray_lengths.begin(), table.ray_lengths.end()), table.ray_lengths.end());
+    if (table.ray_lengths.empty() || table.ray_lengths.front() <= 0) {
+        throw std::invalid_argument("Ray lengths must be positive.");
+    }
+    const int max_length = table.ray_lengths.back();
+
+    table.column_begin.reserve(sample_positions.size() + 1);
+    table.length_end.reserve(sample_positions.size() * table.ray_lengths.size());
+    table.offsets.reserve(sample_positions.size() * max_length);
+    table.column_begin.push_back(0);
+
+    for (size_t i = 0; i < sample_positions.size(); i++) {
+        float angle = start_angle + sample_positions[i];
+        float theta = angle * M_PI / 180.0f;
+
+        float x = h + a * cos(theta);
+        float y = k + b * sin(theta);
+
+        float reverse_angle = 540.0f - angle;
+        float asteroid_theta = reverse_angle * M_PI / 180.0f;
+
+        float rotation_center_x = h + (box_param.size.width / 2.0f) * std::pow(std::cos(asteroid_theta), 3);
+        float rotation_center_y = k + (box_param.size.height / 2.0f) * std::pow(std::sin(asteroid_theta), 3);
+        cv::Point rotation_center(cvRound(rotation_center_x), cvRound(rotation_center_y));
+
+        float ray_slope = (y - rotation_center.y) / (x - rotation_center.x);
+        std::vector<std::pair<int, int>> ray_pixels = getOutwardLinePixels(x, y, ray_slope, max_length);
+
+        // Keep only the pixels inside the slice, recording where each ray length ends
+        size_t j = 0;
+        for (int n = 0; n < max_length; n++) {
+            const long px = ray_pixels[n].first - corner.x;
+            const long py = ray_pixels[n].second - corner.y;
+            if (px >= 0 && px < static_cast<long>(width) && py >= 0 && py < static_cast<long>(height)) {
+                table.offsets.push_back(static_cast<std::ptrdiff_t>(py * static_cast<long>(width) + px));
+            }
+            if (n + 1 == table.ray_lengths[j]) {
+                table.length_end.push_back(table.offsets.size());
+                j++;
+            }
+        }
+        table.column_begin.push_back(table.offsets.size());
+    }
+
+    return table;
+}
+
+
+// Bounding rectangle of the rays: arch points (ellipse between 160 and 380 degrees) +- half a ray
+cv::Rect poemi::calc_sampling_rect(
+    const BoxParam &box_param,
+    const int &ray_length,
+    const std::size_t &width,
+    const std::size_t &height
+) {
+    const double h = box_param.center.x;
+    const double k = box_param.center.y + box_param.size.height / 2;
+    const double a = 4 * box_param.size.width / 10.0;
+    const double b = 8 * box_param.size.height / 10.0;
+
+    // sin over the sampled angles (the last sample may pass the end angle by one shift step)
+    const double first = 160.0, last = 381.0;
+    auto passes = [&](const double &peak) {
+        return peak + 360.0 * std::ceil((first - peak) / 360.0) <= last;
+    };
+    const double sin_first = std::sin(first * M_PI / 180.0);
+    const double sin_last = std::sin(last * M_PI / 180.0);
+    const double sin_min = passes(270.0) ? -1.0 : std::min(sin_first, sin_last);
+    const double sin_max = passes(90.0) ? 1.0 : std::max(sin_first, sin_last);
+
+    // Rays are centred on the arch; one more pixel for rounding
+    const double reach = ray_length / 2.0 + 1;
+    const int x0 = std::max(static_cast<int>(std::floor(h - a - reach)), 0);
+    const int y0 = std::max(static_cast<int>(std::floor(k + b * sin_min - reach)), 0);
+    const int x1 = std::min(static_cast<int>(std::ceil(h + a + reach)) + 1, static_cast<int>(width));
+    const int y1 = std::min(static_cast<int>(std::ceil(k + b * sin_max + reach)) + 1, static_cast<int>(height));
+
+    return cv::Rect(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+}
+
+
 //  for Multi Synthesis
-template <typename PixelType>
+template <typename PixelType, typename Aggregation>
 typename itk::Image<PixelType, 2>::Pointer
 poemi::compute_panoramic_image(
     const typename itk::Image<PixelType, 3>::Pointer &img,
     const BoxParam &box_param,
     const int &ray_length,
-    const std::string &aggregation_method
+    const bool &clamp,
+    const cv::Point &corner
 ) {
     // パラメータ設定
-    float h = box_param.center.x;
-    float k = box_param.center.y + box_param.size.height / 2;
     float a = 4 * box_param.size.width / 10.0f;
     float b = 8 * box_param.size.height / 10.0f;
 
     float start_angle = 160.0f;
     float end_angle = 380.0f;
 
-    float dz = img->GetSpacing()[2];
     size_t z_slices = img->GetLargestPossibleRegion().GetSize(2);
     float mean_shift = (end_angle - start_angle) / 2378;
-    float min_shift = mean_shift * 0.8;
-    float max_shift = mean_shift * 1.2;
     float z_step = static_cast<float>(z_slices) / 1160;
 
-    std::vector<double> sample_positions;
-    for (float angle = start_angle, cumulative_length = 0; angle < end_angle;) {
-        float adaptive_shift = parida::calc_shift_step(angle, min_shift, max_shift, a, b);
-        if ((angle >= 160.0f && angle < 180.0f) || (angle > 360.0f && angle <= 380.0f)) {
-            adaptive_shift = max_shift;
-        }
-        cumulative_length += adaptive_shift;
-        sample_positions.push_back(cumulative_length);
-        angle += adaptive_shift;
-    }
+    std::vector<double> sample_positions = calc_sample_positions(start_angle, end_angle, mean_shift, a, b);
 
     typename itk::Image<PixelType, 2>::SizeType size_img;
     size_img[0] = sample_positions.size();
@@ -284,101 +459,247 @@ poemi::compute_panoramic_image(
     img2d->SetRegions(region);
     img2d->Allocate();
     img2d->FillBuffer(0);
+
+    const size_t width = img->GetLargestPossibleRegion().GetSize(0);
+    const size_t height = img->GetLargestPossibleRegion().GetSize(1);
+    const RayTable ray_table = parida::build_ray_table(box_param, sample_positions, start_angle, ray_length, width, height, corner);
+
+    const double delta = img->GetSpacing()[0];
+    const std::ptrdiff_t slice_stride = static_cast<std::ptrdiff_t>(width * height);
+
+    // Upper sample bound: the usual HU guard, or the CT window when the volume was not windowed
+    const double sample_max = clamp ? panorama::HU_MAX : 4095.0;
+
+    const PixelType* buffer = img->GetBufferPointer();
+    PixelType* panorama = img2d->GetBufferPointer();
+
+    // Clamped samples of one ray, gathered contiguously for the reduction
+    std::vector<double> values;
  
-    for (double z = 0; z < img->GetLargestPossibleRegion().GetSize(2); z += z_step) {
+    for (double z = 0; z < z_slices; z += z_step) {
         size_t rounded_z = static_cast<size_t>(std::round(z));
-        if (rounded_z >= img->GetLargestPossibleRegion().GetSize(2)) break;
-        for (int i = 0; i < static_cast<int>(sample_positions.size()); i++) {
-            float angle = start_angle + sample_positions[i];
-            float theta = angle * M_PI / 180.0f;
+        if (rounded_z >= z_slices) break;
 
-            float x = h + a * cos(theta);
-            float y = k + b * sin(theta);
+        const size_t row = static_cast<size_t>(z / z_step);
+        if (row >= size_img[1]) break;
 
-            float reverse_angle = 540.0f - angle;
-            float asteroid_theta = reverse_angle * M_PI / 180.0f;
+        const PixelType* slice = buffer + rounded_z * slice_stride;
 
-            float rotation_center_x = h + (box_param.size.width / 2.0f) * std::pow(std::cos(asteroid_theta), 3);
-            float rotation_center_y = k + (box_param.size.height / 2.0f) * std::pow(std::sin(asteroid_theta), 3);
-            cv::Point rotation_center(cvRound(rotation_center_x), cvRound(rotation_center_y));
+        for (size_t i = 0; i < sample_positions.size(); i++) {
+            const size_t begin = ray_table.column_begin[i];
+            const size_t valid_pixel_count = ray_table.column_begin[i + 1] - begin;
+            if (valid_pixel_count == 0) continue;
 
-            float ray_slope = (y - rotation_center.y) / (x - rotation_center.x);
-            std::vector<std::pair<int, int>> perp_pixels = parida::getPerpendicularLinePixels(x, y, ray_slope, ray_length);
+            values.resize(valid_pixel_count);
+            for (size_t j = 0; j < valid_pixel_count; j++) {
+                values[j] = std::clamp(static_cast<double>(slice[ray_table.offsets[begin + j]]), -1024.0, sample_max);
+            }
 
-            double sum = 0.0;
-            double exp_sum = 0.0;
-            double trans_sum = 0.0;
-            double max_val = std::numeric_limits<double>::lowest();
-            int valid_pixel_count = 0;
-            const double beta = 0.5;
-            const double delta = img->GetSpacing()[0];  
-            const double S = 300;
+            Aggregation aggregation;
+            aggregation.accumulate(values.data(), valid_pixel_count, delta);
+            double panoramic_value = aggregation.finalize(valid_pixel_count, delta);
+            panorama[row * size_img[0] + i] = static_cast<short>(panoramic_value);
+        }
+    }
 
-            for (const auto &pixel : perp_pixels) {
-                size_t normalX = static_cast<long>(pixel.first);
-                size_t normalY = static_cast<long>(pixel.second);
+    return img2d;
+}
 
-                if (normalX >= 0 && normalX < img->GetLargestPossibleRegion().GetSize(0) &&
-                    normalY >= 0 && normalY < img->GetLargestPossibleRegion().GetSize(1)) {
 
-                    typename itk::Image<PixelType, 3>::IndexType idx3 = {
-                        static_cast<long>(normalX), static_cast<long>(normalY), static_cast<long>(rounded_z)};
-                    auto pixel_value = img->GetPixel(idx3);
+template <typename PixelType>
+typename itk::Image<PixelType, 2>::Pointer
+poemi::compute_panoramic_image(
+    const typename itk::Image<PixelType, 3>::Pointer &img,
+    const BoxParam &box_param,
+    const int &ray_length,
+    const std::string &aggregation_method,
+    const bool &clamp,
+    const cv::Point &corner
+) {
+    if (aggregation_method == "mean") {
+        return compute_panoramic_image<PixelType, MeanAggregation>(img, box_param, ray_length, clamp, corner);
+    } else if (aggregation_method == "max") {
+        return compute_panoramic_image<PixelType, MaxAggregation>(img, box_param, ray_length, clamp, corner);
+    } else if (aggregation_method == "logarithm") {
+        return compute_panoramic_image<PixelType, LogSumExpAggregation>(img, box_param, ray_length, clamp, corner);
+    } else if (aggregation_method == "transmittance") {
+        return compute_panoramic_image<PixelType, TransmittanceAggregation>(img, box_param, ray_length, clamp, corner);
+    }
+    throw std::invalid_argument("Unknown aggregation method: " + aggregation_method);
+}
 
-                    if constexpr (std::is_same_v<PixelType, double>) {
-                        pixel_value = std::clamp(pixel_value, -1024.0, 4095.0);
-                    } else if constexpr (std::is_same_v<PixelType, short>) {
-                        pixel_value = std::clamp(pixel_value, static_cast<short>(-1024), static_cast<short>(4095));
-                    }
-                    sum += pixel_value;
-                    exp_sum += std::exp(pixel_value / S);
-                    max_val = std::max(max_val, static_cast<double>(pixel_value));
-                    valid_pixel_count++;
 
-                    // transmittance用：正規化 + 専用積分
-                    double trans_pixel = std::clamp(static_cast<double>(pixel_value), 0.0, 3071.0) / 3071.0;
-                    /*
-                    double trans_pixel = std::clamp(
-                        static_cast<double>(pixel_value), 0.0, static_cast<double>(max_pixel_value)
-                    ) / static_cast<double>(max_pixel_value);
-                    */
-                    trans_sum += trans_pixel * delta;
-                    
-                }
+// Multi Synthesis in a single sweep: every ray is walked once from its centre outwards and
+// all (aggregation, ray length) outputs are filled from the running partial sums
+template <typename PixelType>
+std::vector<typename itk::Image<PixelType, 2>::Pointer>
+poemi::compute_panoramic_images(
+    const typename itk::Image<PixelType, 3>::Pointer &img,
+    const BoxParam &box_param,
+    const std::vector<std::pair<std::string, int>> &tasks,
+    const bool &clamp,
+    const cv::Point &corner
+) {
+    enum class Aggregation { mean, max, logarithm, transmittance };
+
+    // Resolve aggregation methods once, before touching the volume
+    std::vector<Aggregation> methods;
+    std::vector<int> ray_lengths;
+    bool use_mean = false, use_max = false, use_exp = false, use_trans = false;
+    for (const auto &[method, ray_length] : tasks) {
+        if (method == "mean") {
+            methods.push_back(Aggregation::mean);
+            use_mean = true;
+        } else if (method == "max") {
+            methods.push_back(Aggregation::max);
+            use_max = true;
+        } else if (method == "logarithm") {
+            methods.push_back(Aggregation::logarithm);
+            use_exp = true;
+        } else if (method == "transmittance") {
+            methods.push_back(Aggregation::transmittance);
+            use_trans = true;
+        } else {
+            throw std::invalid_argument("Unknown aggregation method: " + method);
+        }
+        ray_lengths.push_back(ray_length);
+    }
+
+    std::vector<typename itk::Image<PixelType, 2>::Pointer> images;
+    if (tasks.empty()) {
+        return images;
+    }
+
+    // パラメータ設定
+    float a = 4 * box_param.size.width / 10.0f;
+    float b = 8 * box_param.size.height / 10.0f;
+
+    float start_angle = 160.0f;
+    float end_angle = 380.0f;
+
+    size_t z_slices = img->GetLargestPossibleRegion().GetSize(2);
+    float mean_shift = (end_angle - start_angle) / 2378;
+    float z_step = static_cast<float>(z_slices) / 1160;
+
+    std::vector<double> sample_positions = calc_sample_positions(start_angle, end_angle, mean_shift, a, b);
+
+    const size_t width = img->GetLargestPossibleRegion().GetSize(0);
+    const size_t height = img->GetLargestPossibleRegion().GetSize(1);
+    const NestedRayTable ray_table = build_nested_ray_table(box_param, sample_positions, start_angle, ray_lengths, width, height, corner);
+    const size_t n_lengths = ray_table.ray_lengths.size();
+
+    // Group tasks by their position in the sorted ray length list
+    std::vector<std::vector<size_t>> tasks_by_length(n_lengths);
+    for (size_t t = 0; t < tasks.size(); t++) {
+        const auto it = std::lower_bound(ray_table.ray_lengths.begin(), ray_table.ray_lengths.end(), ray_lengths[t]);
+        tasks_by_length[it - ray_table.ray_lengths.begin()].push_back(t);
+    }
+
+    typename itk::Image<PixelType, 2>::SizeType size_img;
+    size_img[0] = sample_positions.size();
+    size_img[1] = z_slices / z_step;
+
+    typename itk::Image<PixelType, 2>::RegionType region;
+    region.SetSize(size_img);
+    region.SetIndex({0, 0});
+
+    std::vector<PixelType*> panoramas;
+    for (size_t t = 0; t < tasks.size(); t++) {
+        typename itk::Image<PixelType, 2>::Pointer img2d = itk::Image<PixelType, 2>::New();
+        img2d->SetRegions(region);
+        img2d->Allocate();
+        img2d->FillBuffer(0);
+        panoramas.push_back(img2d->GetBufferPointer());
+        images.push_back(img2d);
+    }
+
+    const double delta = img->GetSpacing()[0];
+    // Upper sample bound: the usual HU guard, or the CT window when the volume was not windowed
+    const double sample_max = clamp ? panorama::HU_MAX : 4095.0;
+
+    const std::ptrdiff_t slice_stride = static_cast<std::ptrdiff_t>(width * height);
+    const PixelType* buffer = img->GetBufferPointer();
+
+    // Clamped samples of one ray, gathered contiguously for the reductions
+    std::vector<double> values;
+
+    for (double z = 0; z < z_slices; z += z_step) {
+        size_t rounded_z = static_cast<size_t>(std::round(z));
+        if (rounded_z >= z_slices) break;
+
+        const size_t row = static_cast<size_t>(z / z_step);
+        if (row >= size_img[1]) break;
+
+        const PixelType* slice = buffer + rounded_z * slice_stride;
+
+        for (size_t i = 0; i < sample_positions.size(); i++) {
+            const size_t begin = ray_table.column_begin[i];
+            const size_t n_samples = ray_table.column_begin[i + 1] - begin;
+
+            values.resize(n_samples);
+            for (size_t j = 0; j < n_samples; j++) {
+                values[j] = std::clamp(static_cast<double>(slice[ray_table.offsets[begin + j]]), -1024.0, sample_max);
             }
 
-            double panoramic_value = 0.0;
-            
-            if (valid_pixel_count > 0) {
-                if (aggregation_method == "mean") {
-                    panoramic_value = sum / valid_pixel_count;
-                } else if (aggregation_method == "max") {
-                    panoramic_value = max_val;
-                } else if (aggregation_method == "logarithm") {
-                    panoramic_value = S * std::log(exp_sum);
-                } else if (aggregation_method == "transmittance") {
-                    double attenuation = beta * trans_sum;
-                    attenuation = std::clamp(attenuation, 0.0, 20.0);  
-                    double T = std::exp(-attenuation);
-                    panoramic_value = (1.0 - T) * 4095.0;  
-                } else {
-                    throw std::invalid_argument("Unknown aggregation method: " + aggregation_method);
+            MeanAggregation mean;
+            MaxAggregation max;
+            LogSumExpAggregation logarithm;
+            TransmittanceAggregation transmittance;
+            size_t pos = 0;
+
+            for (size_t l = 0; l < n_lengths; l++) {
+                // Extend the partial reductions up to the end of the next ray length
+                const size_t stop = ray_table.length_end[i * n_lengths + l] - begin;
+                if (use_mean) mean.accumulate(values.data() + pos, stop - pos, delta);
+                if (use_max) max.accumulate(values.data() + pos, stop - pos, delta);
+                if (use_exp) logarithm.accumulate(values.data() + pos, stop - pos, delta);
+                if (use_trans) transmittance.accumulate(values.data() + pos, stop - pos, delta);
+                pos = stop;
+
+                const size_t valid_pixel_count = stop;
+                if (valid_pixel_count == 0) continue;
+
+                for (const size_t t : tasks_by_length[l]) {
+                    double panoramic_value = 0.0;
+                    switch (methods[t]) {
+                        case Aggregation::mean:
+                            panoramic_value = mean.finalize(valid_pixel_count, delta);
+                            break;
+                        case Aggregation::max:
+                            panoramic_value = max.finalize(valid_pixel_count, delta);
+                            break;
+                        case Aggregation::logarithm:
+                            panoramic_value = logarithm.finalize(valid_pixel_count, delta);
+                            break;
+                        case Aggregation::transmittance:
+                            panoramic_value = transmittance.finalize(valid_pixel_count, delta);
+                            break;
+                    }
+                    panoramas[t][row * size_img[0] + i] = static_cast<short>(panoramic_value);
                 }
             }
-            typename itk::Image<PixelType, 2>::IndexType idx2 = {
-                static_cast<long>(i), static_cast<long>(z / z_step)};
-            img2d->SetPixel(idx2, static_cast<short>(panoramic_value));
         }
     }
 
-    return img2d;
+    return images;
 }
 
 
 #define PIXEL_TYPE_SYNTHESIS(T) \
-    template BoxParam parida::calc_jaw_area_param<T>(const typename itk::Image<T, 2>::Pointer &img); \
     template itk::Image<T, 2>::Pointer parida::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param); \
-    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const std::string &aggregation_method);
+    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T, poemi::MeanAggregation>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const bool &clamp, const cv::Point &corner); \
+    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T, poemi::MaxAggregation>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const bool &clamp, const cv::Point &corner); \
+    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T, poemi::LogSumExpAggregation>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const bool &clamp, const cv::Point &corner); \
+    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T, poemi::TransmittanceAggregation>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const bool &clamp, const cv::Point &corner); \
+    template itk::Image<T, 2>::Pointer poemi::compute_panoramic_image<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const int &ray_length, const std::string &aggregation_method, const bool &clamp, const cv::Point &corner); \
+    template std::vector<itk::Image<T, 2>::Pointer> poemi::compute_panoramic_images<T>(const typename itk::Image<T, 3>::Pointer &img, const BoxParam &box_param, const std::vector<std::pair<std::string, int>> &tasks, const bool &clamp, const cv::Point &corner);
 
 PIXEL_TYPE_SYNTHESIS(double)
-PIXEL_TYPE_SYNTHESIS(short)
\ No newline at end of file
+PIXEL_TYPE_SYNTHESIS(short)
+
+#define MASK_TYPE_SYNTHESIS(T) \
+    template BoxParam parida::calc_jaw_area_param<T>(const typename itk::Image<T, 2>::Pointer &img);
+
+MASK_TYPE_SYNTHESIS(double)
+MASK_TYPE_SYNTHESIS(short)
+MASK_TYPE_SYNTHESIS(unsigned char)
\ No newline at end of file
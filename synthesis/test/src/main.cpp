@@ -9,7 +9,10 @@
 #include <utils/dataset.hpp>
 #include <image/core.hpp>
 #include <image/io.hpp>
+#include <image/writer.hpp>
+#include <image/nifti.hpp>
 #include <image/mip.hpp>
+#include <image/view.hpp>
 #include <image/mask.hpp>
 
 #include <hist/core.hpp>
@@ -29,11 +32,19 @@ int main() {
     const auto SRC_ROOT = HOME / "workspace" / "kobe" / "data"/ "mcanal" / "ct";
     const auto DST_ROOT = HOME / "workspace" / "kobe" / "synthesis" / "_out" / "test";
     
-    const utils::Dataset dataset(SRC_ROOT / "data.yml");
-    #pragma omp parallel for 
-    for (size_t i = 0; i < dataset.size(); i++) {
-    //for (size_t i = 0; i < 1; i++) {
-        boost::filesystem::path ct_image_path = dataset.image_path(i);
+    utils::Dataset dataset(SRC_ROOT / "data.yml");
+    // Largest volumes first, handed out one at a time
+    dataset.probe();
+    const std::vector<std::size_t> order = dataset.schedule();
+
+    // Artifacts are encoded and written off the compute threads
+    const std::size_t WRITER_THREADS = 2;
+    panorama::AsyncWriter writer(WRITER_THREADS);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t k = 0; k < order.size(); k++) {
+    //for (size_t k = 0; k < 1; k++) {
+        boost::filesystem::path ct_image_path = dataset.image_path(order[k]);
         std::string input_number;
         std::smatch match;
         const std::regex number_regex(R"((\d{3})\D*$)");
@@ -43,11 +54,15 @@ int main() {
         std::cout << input_number << std::endl;
         std::string output_filename = "vanitas vanitatum, et omnia vanitas" + input_number;
         boost::filesystem::path output_path = DST_ROOT / output_filename;
+        // .nii.gz inputs are decompressed once into the cache so later runs can map them
+        const std::string ct_path = panorama::cache_nifti(ct_image_path.string(), (DST_ROOT / "Cache").string());
         Image3D::Pointer img_ct = panorama::read_image<PixelType>(
-            ct_image_path.string()
+            ct_path
         );
         
-        img_ct = panorama::window_ct_image<PixelType>(img_ct);
+        panorama::window_ct_image_inplace<PixelType>(img_ct);
+        // Isotropic voxels (slices resampled to the in-plane spacing) before any slice range is derived
+        img_ct = panorama::resampling_ct_image<PixelType>(img_ct);
         Image2D::Pointer coronal_mip = panorama::compute_coronal_mip_image<PixelType>(img_ct);
 
         /*
@@ -71,7 +86,7 @@ int main() {
         boost::filesystem::create_directories(DST_ROOT / "Coronal Tooth");
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Coronal Tooth" / output_filename;
-        cv::imwrite(output_path.string(), img_coronal_tooth);
+        writer.write_jpeg(img_coronal_tooth, output_path.string());
 
         coronal_tooth = panorama::process_tooth_mask<PixelType>(coronal_tooth);
         double coronal_tilt_angle = poemi::calc_coronal_tilt_angle<PixelType>(coronal_tooth);
@@ -80,17 +95,17 @@ int main() {
          * Tilt correction (regarding coronal reference plane)
          */
 
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'y', coronal_correction_angle);
+        itk::Matrix<double, 3, 3> pose = panorama::calc_rotation_matrix('y', coronal_correction_angle);
         cv::Mat img_coronal_plane = panorama::draw_sagittal_plane<PixelType>(coronal_tooth, coronal_tooth);
         boost::filesystem::create_directories(DST_ROOT / "Coronal Plane");
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Coronal Plane" / output_filename;
-        cv::imwrite(output_path.string(), img_coronal_plane);
+        writer.write_jpeg(img_coronal_plane, output_path.string());
         img_coronal_plane = panorama::draw_sagittal_plane<PixelType>(coronal_mip, coronal_tooth);
         boost::filesystem::create_directories(DST_ROOT / "Coronal MIP");
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Coronal MIP" / output_filename;
-        cv::imwrite(output_path.string(), img_coronal_plane);
+        writer.write_jpeg(img_coronal_plane, output_path.string());
 
         //Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
 
@@ -126,8 +141,8 @@ int main() {
         /*
          * Extract ROI slices
          */
-        Image3D::Pointer roi_ct = panorama::extract_slices<PixelType>(img_ct, roi_range);
-        Image2D::Pointer axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
+        Image2D::Pointer axial_mip = panorama::compute_axial_mip_image<PixelType>(
+            panorama::TransformedVolume<PixelType>(img_ct, pose, roi_range));
         Image2D::Pointer axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
         axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
 
@@ -137,13 +152,14 @@ int main() {
         double sagittal_tilt_angle = parida::calc_sagittal_tilt_angle<PixelType>(axial_mask);
         double correction_angle = parida::calc_sagittal_correction_angle(sagittal_tilt_angle);
         // Rotate around the superior-inferior axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'z', correction_angle);
-        roi_ct = panorama::rotate_ct_image<PixelType>(roi_ct, 'z', correction_angle);
+        // (rotations are accumulated in pose; MIPs interpolate through it, only the sampling slices are resampled)
+        pose = pose * panorama::calc_rotation_matrix('z', correction_angle);
+        const panorama::TransformedVolume<PixelType> posed_ct(img_ct, pose);
   
         /*
          * Jaw area detection using axial MIP from ROI slices
          */
-        axial_mip = panorama::compute_axial_mip_image<PixelType>(roi_ct);
+        axial_mip = panorama::compute_axial_mip_image<PixelType>(posed_ct.slices(roi_range));
         axial_mask = panorama::compute_mask_image<PixelType>(axial_mip, bone_threshold);
         axial_mask = panorama::process_jaw_mask<PixelType>(axial_mask);
         BoxParam jaw_area_param = parida::calc_jaw_area_param<PixelType>(axial_mask);
@@ -151,22 +167,22 @@ int main() {
         /*
          * Tilt correction (regarding axial reference plane)
          */
-        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
+        Image2D::Pointer sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(posed_ct);
         Image2D::Pointer sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
         sagittal_mask = panorama::process_tooth_mask<PixelType>(sagittal_mask);
         double axial_tilt_angle = poemi::calc_axial_tilt_angle<PixelType>(sagittal_mask);
         correction_angle = poemi::calc_axial_correction_angle(axial_tilt_angle);
 
         // Rotate around the left-right axis
-        img_ct = panorama::rotate_ct_image<PixelType>(img_ct, 'x', correction_angle);
-        sagittal_mip = panorama::compute_sagittal_mip_image<PixelType>(img_ct);
-        sagittal_mask = panorama::compute_mask_image<PixelType>(sagittal_mip, tooth_threshold);
+        pose = pose * panorama::calc_rotation_matrix('x', correction_angle);
 
         /*
          * Sampling CT slice
          */
         Range sampling_slice_range = poemi::calc_sampling_slice_range(horizontal_hist);
-        img_ct = panorama::extract_slices<PixelType>(img_ct, sampling_slice_range);
+        // Single resampling of the corrected pose, cropped to the sampling slices
+        // (three shears when only one tilt was corrected)
+        img_ct = panorama::transform_ct_image<PixelType>(img_ct, pose, sampling_slice_range, panorama::RotationEngine::Shear);
 
         /*
          * Synthesis panoramic X-ray Image
@@ -181,7 +197,7 @@ int main() {
         cv::Mat img_debug_panorama = panorama::draw_2d_image<PixelType>(img_panorama);
         output_filename = input_number + ".jpg";
         output_path = DST_ROOT / "Sharpen Panorama2" / output_filename;
-        cv::imwrite(output_path.string(), img_debug_panorama);
+        writer.write_jpeg(img_debug_panorama, output_path.string());
         
     }   
 
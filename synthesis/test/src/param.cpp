@@ -4,6 +4,7 @@
 #include <itkNiftiImageIO.h>
 
 #include <image/core.hpp>
+#include <image/mat.hpp>
 #include <hist/core.hpp>
 #include <hist/peak.hpp>
 
@@ -71,15 +72,11 @@ panorama::calc_roi_range(const std::vector<short>& curve) {
 // Tilt from Sagittal Reference Plane
 template <typename PixelType>
 double parida::calc_sagittal_tilt_angle(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1), const_cast<PixelType*>(img->GetBufferPointer()));
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
+    // Mask pixels are 0 or positive integers for every PixelType: saturate foreground to 255
     cv::Mat img_8bit;
-    if (std::is_integral<PixelType>::value) {
-        img_cv.convertTo(img_8bit, CV_8UC1);
-    } else {
-        img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
-    }
+    img_cv.convertTo(img_8bit, CV_8UC1, 255.0);
 
     cv::Mat binary;
     cv::threshold(img_8bit, binary, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
@@ -105,15 +102,7 @@ double parida::calc_sagittal_correction_angle(const double& angle) {
 // Tilt from Axial Reference Plane
 template <typename PixelType>
 double poemi::calc_axial_tilt_angle(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> it(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++it) {
-            img_cv.at<PixelType>(y, x) = it.Get();
-        }
-    }
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
     cv::Mat img_8bit;
     img_cv.convertTo(img_8bit, CV_8UC1);
@@ -155,15 +144,7 @@ double poemi::calc_axial_correction_angle(const double& angle) {
 // Tilt from Axial Reference Plane
 template <typename PixelType>
 double poemi::calc_coronal_tilt_angle(const typename itk::Image<PixelType, 2>::Pointer& img) {
-    auto size = img->GetLargestPossibleRegion().GetSize();
-    cv::Mat img_cv(size[1], size[0], CV_MAKETYPE(cv::DataType<PixelType>::depth, 1));
-
-    itk::ImageRegionConstIterator<itk::Image<PixelType, 2>> it(img, img->GetLargestPossibleRegion());
-    for (int y = 0; y < img_cv.rows; ++y) {
-        for (int x = 0; x < img_cv.cols; ++x, ++it) {
-            img_cv.at<PixelType>(y, x) = it.Get();
-        }
-    }
+    const cv::Mat img_cv = panorama::as_mat<PixelType>(img);
 
     cv::Mat img_8bit;
     img_cv.convertTo(img_8bit, CV_8UC1);